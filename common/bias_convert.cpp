@@ -0,0 +1,82 @@
+/*
+	Bias Store Converter - Text Results to Binary Columnar Format
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This program converts an existing text output file of the data generation programs \
+	  (siphash21_biastest, siphash21_condtest_k, siphash21_newcondtest_k) into the binary format of biasstore.h, \
+	  written next to it with the extension ".bin", so that the analysis programs can load it through mmap.
+	The values are stored with the same two decimals as the text file, so the analysis gives the same results from either file.
+	k and n are taken from the file name "sip21test_k.txt" or "sip21test_k_n.txt"; the number of keys is counted from the file.
+
+	Program must be executed with 2 operational parameters, the generator that wrote the file and the file, \
+	  and 1 optional operational parameter, the pairs per key of that run (default 1048576, only recorded in the header).
+	i.e.:
+		./bias_convert biastest ../siphash21/biastest/data/sip21test_07.txt
+		./bias_convert condtest ../siphash21/condtest/data/sip21test_32_0.txt
+		./bias_convert newcondtest ../recovery/data/sip21test_33_0.txt 1048576
+
+	Output Format
+		One binary file, and one line of standard output.
+	i.e.:
+		../siphash21/biastest/data/sip21test_07.bin keys:4096
+*/
+
+#include<iostream>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<vector>
+#include"biasstore.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	if (argc<3)
+	{
+		printf("usage: %s biastest|condtest|newcondtest sip21test_k[_n].txt [inputnum]\n",argv[0]);
+		return -1;
+	}
+	//variant
+	int variant,groups;
+	if (strcmp(argv[1],"biastest")==0) variant = SIPBIAS_BIASTEST,groups = 1;
+	else if (strcmp(argv[1],"condtest")==0) variant = SIPBIAS_CONDTEST,groups = 4;
+	else if (strcmp(argv[1],"newcondtest")==0) variant = SIPBIAS_NEWCONDTEST,groups = 2;
+	else
+	{
+		printf("unknown generator %s\n",argv[1]);
+		return -1;
+	}
+	long long inputnum = (argc>3)?atoll(argv[3]):1048576;
+	//k and n from the file name
+	const char* base = strrchr(argv[2],'/');
+	base = (base==NULL)?argv[2]:base+1;
+	int k = -1,n = -1;
+	if (sscanf(base,"sip21test_%d_%d.txt",&k,&n)<1)
+	{
+		printf("cannot parse k from %s\n",base);
+		return -1;
+	}
+	if (variant==SIPBIAS_BIASTEST) n = -1;
+	//load
+	biaswriter w;
+	if (!biaswriter_parse_text(w,argv[2],variant,k,n,groups,inputnum))
+	{
+		printf("cannot parse %s\n",argv[2]);
+		return -1;
+	}
+	long long keynum = w.head.keynum;
+	//write
+	char binname[1024];
+	snprintf(binname,sizeof(binname),"%s",argv[2]);
+	char* dot = strrchr(binname,'.');
+	if (dot!=NULL) *dot = '\0';
+	strncat(binname,".bin",sizeof(binname)-strlen(binname)-1);
+	if (!biaswriter_save(w,binname))
+	{
+		printf("cannot write %s\n",binname);
+		return -1;
+	}
+	printf("%s keys:%lld\n",binname,keynum);
+	return 0;
+}
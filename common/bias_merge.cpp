@@ -0,0 +1,131 @@
+/*
+	Bias Store Merger - Adding Up Shards of a Generator Run
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This program adds up the raw counters of several .bin files written by the data generation programs \
+	  (siphash21_biastest, siphash21_condtest_k, siphash21_newcondtest_k) with option "--shard i", or by separate extensions, \
+	  and writes one run of the total size, in both the binary format of biasstore.h and the text format of the generators.
+	The shards must be finished runs (not the files saved at the checkpoints of an interrupted run) \
+	  of the same program with the same k, n, seed and keys, \
+	  and their messages must follow each other in the streams (e.g. shards 0,1,2,3 of the same inputnum), \
+	  so that the merged file covers messages first..first+inputnum-1 and can still be extended with option "--extend N".
+	The result is exactly the file one run of the total size would have written.
+
+	Program must be executed with 1 output file name (ending with ".bin") and at least 1 input file.
+	i.e.:
+		./bias_merge sip21test_07.bin shard0/sip21test_07.bin shard1/sip21test_07.bin shard2/sip21test_07.bin shard3/sip21test_07.bin
+
+	Output Format
+		The merged "sip21test_*.bin" and "sip21test_*.txt", and one line of standard output.
+	i.e.:
+		sip21test_07.bin keys:4096 samples:0~4194303
+*/
+
+#include<iostream>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<algorithm>
+#include"biasstore.h"
+
+using namespace std;
+
+void fprint_longlong_in_hex(unsigned long long a,FILE* fout)
+{
+	unsigned int left32 = (unsigned int)(a>>32);
+	unsigned int right32 = (unsigned int)((a<<32)>>32);
+	fprintf(fout,"%08x%08x\n",left32,right32);
+}
+
+int main(int argc, char* argv[])
+{
+	if ((argc<3)||(strlen(argv[1])<4)||(strcmp(argv[1]+strlen(argv[1])-4,".bin")!=0))
+	{
+		printf("usage: %s merged.bin shard.bin [shard.bin ...]\n",argv[0]);
+		return -1;
+	}
+	//load
+	int shardnum = argc-2;
+	vector<biaswriter> shard(shardnum);
+	for (int s=0;s<shardnum;s++)
+	{
+		if (!biaswriter_load(shard[s],argv[s+2]))
+		{
+			printf("cannot load %s\n",argv[s+2]);
+			return -1;
+		}
+		if (!shard[s].head.counts)
+		{
+			printf("%s has no counters\n",argv[s+2]);
+			return -1;
+		}
+		if (!shard[s].head.complete)
+		{
+			printf("%s is not a finished run\n",argv[s+2]);
+			return -1;
+		}
+	}
+	//same run, adjacent samples
+	sort(shard.begin(),shard.end(),[](const biaswriter &a,const biaswriter &b){return a.head.first<b.head.first;});
+	const biasheader &head = shard[0].head;
+	long long inputnum = head.inputnum;
+	for (int s=1;s<shardnum;s++)
+	{
+		const biasheader &h = shard[s].head;
+		if ((h.variant!=head.variant)||(h.k!=head.k)||(h.n!=head.n)||(h.groups!=head.groups)||(h.keynum!=head.keynum)||(h.seed!=head.seed)||(shard[s].key!=shard[0].key))
+		{
+			printf("shards belong to different runs\n");
+			return -1;
+		}
+		if (h.first!=head.first+inputnum)
+		{
+			printf("shards do not cover adjacent samples: %lld~%lld missing or repeated\n",head.first+inputnum,h.first-1);
+			return -1;
+		}
+		inputnum += h.inputnum;
+	}
+	//add up
+	long long keynum = head.keynum;
+	biaswriter w;
+	biaswriter_init(w,head.variant,head.k,head.n,head.groups,keynum,inputnum);
+	biaswriter_counts(w,head.seed,head.first);
+	w.head.complete = 1;
+	string txtname = string(argv[1],strlen(argv[1])-4)+".txt";
+	FILE* fout = fopen(txtname.c_str(),"w");
+	if (fout==NULL)
+	{
+		printf("cannot write %s\n",txtname.c_str());
+		return -1;
+	}
+	for (long long i=0;i<keynum;i++)
+	{
+		long long counter[64];
+		double bias[64];
+		for (int j=0;j<64;j++)
+		{
+			counter[j] = 0;
+			for (int s=0;s<shardnum;s++) counter[j] += shard[s].count[j*keynum+i];
+			bias[j] = biasstore_bias_of(counter[j],inputnum);
+		}
+		biaswriter_set(w,i,shard[0].key[2*i],shard[0].key[2*i+1],bias,counter);
+		fprint_longlong_in_hex(shard[0].key[2*i],fout);
+		fprint_longlong_in_hex(shard[0].key[2*i+1],fout);
+		for (int j=0;j<64;j++)
+		{
+			if (j>9) fprintf(fout,"%d ",j);
+			else fprintf(fout,"0%d ",j);
+			fprintf(fout,"%.2f\n",bias[j]);
+		}
+		fprintf(fout,"\n");
+	}
+	fclose(fout);
+	if (!biaswriter_save(w,argv[1]))
+	{
+		printf("cannot write %s\n",argv[1]);
+		return -1;
+	}
+	printf("%s keys:%lld samples:%lld~%lld\n",argv[1],keynum,head.first,head.first+inputnum-1);
+	return 0;
+}
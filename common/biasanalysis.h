@@ -0,0 +1,223 @@
+/*
+	Bias Analysis - Running Statistics of the Analysis Programs
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	The statistics of the analysis programs, kept up to date one key at a time, \
+	  so that they can be fed from a data file by the analysis programs themselves, \
+	  or directly by a data generation program (option "--stream") or by the report program:
+		biasstat: siphash21_analysis.cpp, times of being the greatest, average, biggest and smallest bias of every output bit
+		biascond: siphash21_analysis_k.cpp (4 key groups) and siphash21_newanalysis_k.cpp (2 key groups), \
+		  one histogram of the biases per output bit and key group (biashist.h), swept for the best boundlines at the end
+	Biases are given as bias*100, the two decimals of the data files (biasstore.h), \
+	  so a --stream run prints what the analysis program prints on the data file of the same run.
+
+	Usage:
+		biasstat st;
+		biasstat_init(st);
+		biasstat_add(st,fixed);  //bias*100 of the 64 output bits of the next key
+		biasstat_print(st,stdout);
+		biascond c;
+		biascond_init(c,4,keynum);  //keys i/(keynum/4) in group 0,1,2,3
+		biascond_add(c,i,fixed);  //key i, in any order
+		biascond_print(c,n,stdout);  //after the last key, optionally sweeping the output bits on nthread threads
+*/
+
+#ifndef BIASANALYSIS_H
+#define BIASANALYSIS_H
+
+#include<cstdio>
+#include<cmath>
+#include"biashist.h"
+#include"sipthread.h"
+
+struct biasstat
+{
+	long long keynum;
+	int maxtime[64];  //times of being the greatest
+	double sum[64],max[64],min[64];
+};
+
+static inline void biasstat_init(biasstat &st)
+{
+	st.keynum = 0;
+	for (int j=0;j<64;j++)
+	{
+		st.maxtime[j] = 0;
+		st.sum[j] = 0.0;
+		st.max[j] = -100.0;
+		st.min[j] = 0.0;
+	}
+}
+
+static inline void biasstat_add(biasstat &st,const short* fixed)
+{
+	int maxbias_key = -10000;
+	int maxsite_key = -1;
+	for (int j=0;j<64;j++)
+	{
+		if (fixed[j]>maxbias_key)
+		{
+			maxbias_key = fixed[j];
+			maxsite_key = j;
+		}
+		double bias = fixed[j]/100.0;
+		st.sum[j] = st.sum[j]+bias;
+		if (bias>st.max[j]) st.max[j] = bias;
+		if (bias<st.min[j]) st.min[j] = bias;
+	}
+	st.maxtime[maxsite_key]++;
+	st.keynum++;
+}
+
+//the lines of siphash21_analysis.cpp after "load ... finished"
+static inline void biasstat_print(const biasstat &st,FILE* fout)
+{
+	for (int j=0;j<64;j++)
+	{
+		if (st.maxtime[j]==0) continue;
+		fprintf(fout,"j:%d times:%d average:%.2f max:%.2f min:%.2f\n",j,st.maxtime[j],st.sum[j]/st.keynum,st.max[j],st.min[j]);
+	}
+}
+
+struct biascond
+{
+	int groups;  //4: siphash21_analysis_k.cpp, 2: siphash21_newanalysis_k.cpp
+	long long keynum;
+	biashist h[64];
+	//filled by biascond_sweep
+	double p[64];  //best success rate of output bit j
+	int left[64];  //its boundline lies above bias left[j]/100.0
+	double leftbound[64],rightbound[64];  //and below the next bias present (siphash21_newanalysis_k.cpp)
+	int maxj;  //best output bit, -1 if all biases are less than 2^-9
+};
+
+static inline void biascond_init(biascond &c,int groups,long long keynum)
+{
+	c.groups = groups;
+	c.keynum = keynum;
+	for (int j=0;j<64;j++) biashist_init(c.h[j],groups);
+	c.maxj = -1;
+}
+
+static inline void biascond_add(biascond &c,long long i,const short* fixed)
+{
+	int g = i/(c.keynum/c.groups);
+	for (int j=0;j<64;j++) biashist_add(c.h[j],fixed[j],g);
+}
+
+static inline double biascond_max(double a,double b)
+{
+	if (a>b) return a;
+	else return b;
+}
+
+//success rate of recovering v2[k] with the boundline above the keys counted in below[]
+static inline double biascond_p(const biascond &c,const int* below)
+{
+	double size = c.keynum/c.groups;
+	if (c.groups==2) return (1+fabs(below[0]/size-below[1]/size))/2;
+	double pp0 = below[0]*1.0/size;
+	double qq0 = below[1]*1.0/size;
+	double pp1 = below[2]*1.0/size;
+	double qq1 = below[3]*1.0/size;
+	return (biascond_max(pp0*qq0,pp1*qq1)+biascond_max(pp0+qq0-2*pp0*qq0,pp1+qq1-2*pp1*qq1)+biascond_max((1-pp0)*(1-qq0),(1-pp1)*(1-qq1)))/2;
+}
+
+//best boundline of every output bit (boundlines less than -9 are filtered), one output bit per thread, and the best output bit
+static inline void biascond_sweep(biascond &c,int nthread = 1)
+{
+	sip_parallel_for(nthread,64,[&](long long j,int)
+	{
+		c.p[j] = 0;
+		c.left[j] = 0;
+		c.leftbound[j] = 0.0;
+		c.rightbound[j] = 0.0;
+		biashist_sweep(c.h[j],[&](int v,int next,const int* below)
+		{
+			if (v<-900) return;//bias<-9
+			double p = biascond_p(c,below);
+			if (p>c.p[j])
+			{
+				c.p[j] = p;
+				c.left[j] = v;
+				c.leftbound[j] = v/100.0;
+				if (next==biashist_end) c.rightbound[j] = v/100.0+0.01;
+				else c.rightbound[j] = next/100.0;
+			}
+		});
+	});
+	double maxp = 0;
+	c.maxj = -1;
+	for (int j=0;j<64;j++)
+		if (c.p[j]>maxp)
+		{
+			maxp = c.p[j];
+			c.maxj = j;
+		}
+}
+
+//proportions of keys of each group below the best boundline of output bit j
+static inline void biascond_choice(const biascond &c,int j,double* pp)
+{
+	int below[4];
+	biashist_below(c.h[j],c.left[j],below);
+	for (int g=0;g<c.groups;g++) pp[g] = below[g]*1.0/(c.keynum/c.groups);
+}
+
+//a/b, and 0 for 0/0: in biascond_p_v3 the ratios are 0/0 only when both keys of a group are on the same side of the boundline,
+//and then their weight pp0+qq0-2*pp0*qq0 is 0
+static inline double biascond_ratio(double a,double b)
+{
+	if (b==0) return 0;
+	return a/b;
+}
+
+//success rate of recovering v3[k-1] with the best boundline (4 key groups)
+static inline double biascond_p_v3(const biascond &c)
+{
+	double pp[4];
+	biascond_choice(c,c.maxj,pp);
+	double max1 = biascond_ratio(biascond_max(pp[0],pp[1]),pp[0]+pp[1]);
+	double max2 = biascond_ratio(biascond_max(1-pp[0],1-pp[1]),2-pp[0]-pp[1]);
+	double max3 = biascond_ratio(biascond_max(pp[2],pp[3]),pp[2]+pp[3]);
+	double max4 = biascond_ratio(biascond_max(1-pp[2],1-pp[3]),2-pp[2]-pp[3]);
+	double p0_v3 = (1-pp[0]-pp[1]+2*pp[0]*pp[1])*0.5+(pp[0]+pp[1]-2*pp[0]*pp[1])*biascond_max(max1,max2);
+	double p1_v3 = (1-pp[2]-pp[3]+2*pp[2]*pp[3])*0.5+(pp[2]+pp[3]-2*pp[2]*pp[3])*biascond_max(max3,max4);
+	return (p0_v3+p1_v3)/2;
+}
+
+//the lines of siphash21_analysis_k.cpp (4 key groups) or siphash21_newanalysis_k.cpp (2 key groups, group tag n) after "load ... finished"
+static inline void biascond_print(biascond &c,int n,FILE* fout,int nthread = 1)
+{
+	biascond_sweep(c,nthread);
+	double pp[4];
+	if (c.groups==4)
+	{
+		for (int j=0;j<64;j++) fprintf(fout,"site:%d bound:%.3f p:%.3f\n",j,(c.p[j]>0)?c.leftbound[j]+0.005:0.0,c.p[j]);
+		fprintf(fout,"\n");
+		fprintf(fout,"best choice:\n");
+		if (c.maxj<0) return;
+		fprintf(fout,"site:%d bound:%.3f\n",c.maxj,c.leftbound[c.maxj]+0.005);
+		biascond_choice(c,c.maxj,pp);
+		fprintf(fout,"p1:%.3f q1:%.3f p2:%.3f q2:%.3f p_v2[k]:%.3f ",pp[0],pp[1],pp[2],pp[3],c.p[c.maxj]);
+		fprintf(fout,"p_v3[k-1]:%.3f\n",biascond_p_v3(c));
+		return;
+	}
+	for (int j=0;j<64;j++) fprintf(fout,"site:%d bound:%.3f p:%.3f\n",j,(c.leftbound[j]+c.rightbound[j])/2,c.p[j]);
+	fprintf(fout,"\n");
+	fprintf(fout,"best choices:\n");
+	bool perfect = false;
+	for (int j=0;j<64;j++)
+		if (fabs(1-c.p[j])<1e-6) perfect = true;
+	for (int j=0;j<64;j++)
+	{
+		if (perfect?(fabs(1-c.p[j])>=1e-6):(j!=c.maxj)) continue;
+		fprintf(fout,"site:%d midbound:%.3f leftbound:%.3f rightbound:%.3f\n",j,(c.leftbound[j]+c.rightbound[j])/2,c.leftbound[j],c.rightbound[j]);
+		biascond_choice(c,j,pp);
+		double p = perfect?(1+fabs(pp[0]-pp[1]))/2:c.p[j];
+		if (n==0) fprintf(fout,"p1:%.3f p2:%.3f p_v2[k]:%.3f\n",pp[0],pp[1],p);
+		if (n==1) fprintf(fout,"q1:%.3f q2:%.3f p_v2[k]:%.3f\n",pp[0],pp[1],p);
+	}
+}
+
+#endif
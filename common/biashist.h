@@ -0,0 +1,93 @@
+/*
+	Bias Histogram - Boundline Sweeps without Sorting
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	The boundline search of the condtest analyses needs, for every distinct bias b of one output bit, \
+	  the number of keys of each group with bias <= b.
+	Biases are stored with two decimals (biasstore.h) and lie in [-64,0], so instead of sorting the keys of each output bit \
+	  they are counted into one bin per 0.01 and per key group, and a sweep over the bins in increasing order \
+	  accumulates the counts of each group: O(keynum+bins) per output bit instead of the O(keynum^2) exchange sort.
+	The bins of one bias value are next to each other for all groups, and one histogram is independent of the others, \
+	  so the 64 output bits can be analysed on different threads (sipthread.h).
+
+	Usage:
+		biashist h;
+		biashist_build(h,biasdata[j],flagdata,keynum,4);  //bias*100 and group of every key
+		//or: biashist_init(h,4), then biashist_add(h,bias,flag) for one key at a time
+		biashist_sweep(h,[&](int v,int next,const int* below)
+		{
+			...  //below[g]: keys of group g with bias <= v/100.0, next: following bias present (biashist_end after the last one)
+		});
+*/
+
+#ifndef BIASHIST_H
+#define BIASHIST_H
+
+#include<vector>
+
+const int biashist_min = -6400;  //-64.00, i.e. at most 2^64 pairs per key
+const int biashist_bins = 1-biashist_min;  //-64.00..0.00
+const int biashist_end = 1;  //"next" of the last bias present
+
+struct biashist
+{
+	int groups;
+	int lo,hi;  //smallest and largest bias*100 present
+	std::vector<int> count;  //keys of group g with bias v/100.0 at count[(v-biashist_min)*groups+g]
+};
+
+static inline void biashist_init(biashist &h,int groups)
+{
+	h.groups = groups;
+	h.lo = 0;
+	h.hi = biashist_min;
+	h.count.assign((long long)biashist_bins*groups,0);
+}
+
+//one key with bias v/100.0 in group g
+static inline void biashist_add(biashist &h,int v,int g)
+{
+	if (v<biashist_min) v = biashist_min;
+	if (v>0) v = 0;
+	h.count[(v-biashist_min)*h.groups+g]++;
+	if (v<h.lo) h.lo = v;
+	if (v>h.hi) h.hi = v;
+}
+
+//bias[i] = bias*100 of key i, flag[i] = group of key i (0..groups-1)
+static inline void biashist_build(biashist &h,const short* bias,const int* flag,long long keynum,int groups)
+{
+	biashist_init(h,groups);
+	for (long long i=0;i<keynum;i++) biashist_add(h,bias[i],flag[i]);
+}
+
+//below[g] = keys of group g with bias <= v/100.0
+static inline void biashist_below(const biashist &h,int v,int* below)
+{
+	for (int g=0;g<h.groups;g++) below[g] = 0;
+	for (int w=h.lo;w<=v;w++)
+		for (int g=0;g<h.groups;g++) below[g] += h.count[(w-biashist_min)*h.groups+g];
+}
+
+//f(v,next,below) for every bias v/100.0 present, in increasing order
+template<typename F>
+static void biashist_sweep(const biashist &h,F f)
+{
+	std::vector<int> below(h.groups,0);
+	int v = -1;  //bias of the current bin, waiting for the next one present
+	bool pending = false;
+	for (int w=h.lo;w<=h.hi;w++)
+	{
+		const int* c = &h.count[(w-biashist_min)*h.groups];
+		int sum = 0;
+		for (int g=0;g<h.groups;g++) sum += c[g];
+		if (sum==0) continue;
+		if (pending) f(v,w,below.data());
+		for (int g=0;g<h.groups;g++) below[g] += c[g];
+		v = w;
+		pending = true;
+	}
+	if (pending) f(v,biashist_end,below.data());
+}
+
+#endif
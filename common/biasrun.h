@@ -0,0 +1,341 @@
+/*
+	Bias Run - Shared Driver of the SipHash-2-1 Data Generation Programs
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	siphash21_biastest, siphash21_condtest_k and siphash21_newcondtest_k only differ in how they draw the keys and messages of key i \
+	  and count its output differences; this header runs the rest:
+		the key loop over threads (sipthread.h), the text file "name.txt" and the binary file "name.bin" (biasstore.h), written in key order,
+		the checkpoints (sipcheckpoint.h), the shards and extensions of runs, and the running statistics of "--stream" (biasanalysis.h).
+	Every key is a pure function of the seed and its index (siprng.h), \
+	  so a checkpoint only keeps the seed, the first unfinished key and the length of the text file, \
+	  together with a tag naming the program, its parameters and the output mode.
+
+	Options, removed from the operational parameters by biasrun_options():
+		"-j N" hashes N keys at the same time on N threads ("-j 0": one thread per core); keys are still written in order, \
+		  and with the same seed the output files are the same for any N.
+		"--resume" continues an interrupted run from its last checkpoint "name.txt.ckpt", \
+		  which is rewritten every checkpointinterval(internal parameter of the programs) seconds and removed when the run completes.
+		"--shard i" takes messages i*inputnum..(i+1)*inputnum-1 of every key's stream instead of the first inputnum ones; \
+		  shards of the same k (and n) run under the same SIPHASH_SEED (on different machines or directories) have the same keys, \
+		  and their .bin files are added up by bias_merge.cpp into one run of the total size.
+		"--extend N" adds the next N messages of every key's stream to the finished run in "name.bin" \
+		  (same seed and keys, read from the file), and rewrites both output files with the counters of the whole run, \
+		  e.g. N = 15728640 takes a run of 2^20 messages per key to 2^24 at the cost of the new messages only.
+		  The original .bin is kept as "name.bin.base" until the extension completes, \
+		  and is left in place if it is not a finished run of the same program and parameters.
+		"--stream" does not write the text file: each key is passed, as soon as it is finished, to the running statistics \
+		  of the analysis program (biasstat for 1 key group, biascond for 2 or 4), whose results are printed when the last key is finished.
+		  The .bin file is still written, for checkpoints and for later merges or extensions.
+		"--masks file" replaces the input bit k by the input masks (any 64-bit input differences) \
+		  and the 64 output bits by the output masks (biases of the parity of the output difference on the mask) listed in the file \
+		  (see maskcounter.h), all of them evaluated on the same messages of every key, with the same keys and messages as without the option; \
+		  the generator counts them with siphash_2_1_mask_count when r.maskname is set, and the run is started by biasrun_start_masks.
+		  The output file "<prefix><mask file name>" has one line per input mask and output mask (input mask, output mask, bias) for every key, \
+		  and the standard output gives the times of being the greatest and the average, biggest and smallest biases \
+		  of every pair of masks that has been the greatest for some key, and the pair of masks with the greatest average bias.
+		  There is no .bin file, so the option only goes with "-j N" and "--shard i".
+
+	Usage:
+		biasrun r;
+		biasrun_options(r,argc,argv);
+		if (!biasrun_start(r,"siphash21_biastest 07","sip21test_07",SIPBIAS_BIASTEST,k,-1,1,keynum,inputnum,checkpointinterval)) return -1;
+		biasrun_keys(r,[&](long long i,sipkey &key,long long* counter)
+		{
+			...  //key i, and counter[j] of output bit j over messages r.first..r.first+r.inputnum-1 of its stream
+			//  (with "--masks", counter[a*nout+b] of input mask a and output mask b: siphash_2_1_mask_count(ctx,r.ms,...))
+		});
+		biasrun_finish(r);
+	where "--masks" is started instead by:
+		if (!biasrun_start_masks(r,"sip21mask_",keynum,inputnum)) return -1;
+*/
+
+#ifndef BIASRUN_H
+#define BIASRUN_H
+
+#include<cstdio>
+#include<cstring>
+#include<ctime>
+#include<string>
+#include<vector>
+#include"siphash.h"
+#include"siprng.h"
+#include"sipthread.h"
+#include"sipcheckpoint.h"
+#include"biasstore.h"
+#include"biasanalysis.h"
+#include"maskcounter.h"
+
+struct biasrun
+{
+	//options
+	int nthread;
+	bool resume,streammode;
+	long long shard,extend;
+	const char* maskname;  //"--masks file", NULL without the option
+	//run
+	int variant,k,n,groups;
+	long long keynum;  //keys in the files
+	long long inputnum;  //pairs per key hashed by this execution
+	long long first;  //index of their first message in every key's stream
+	int interval;  //seconds between checkpoints
+	unsigned long long seed;
+	std::string filename,binname,ckptname,tag;
+	biaswriter base;  //finished run being extended
+	biaswriter w;
+	sipcheckpoint cp;
+	FILE* fout;
+	time_t last;
+	biasstat st;  //--stream, 1 key group
+	biascond c;  //--stream, 2 or 4 key groups
+	std::vector<sipkey> keylist;
+	int width;  //counters per key: 64 output bits, or one per pair of masks
+	std::vector<long long> counter;  //width counters per key
+	//--masks
+	maskset ms;
+	std::vector<int> maxtime;  //times of being the greatest of each pair of masks
+	std::vector<double> sum,maxbias,minbias;
+};
+
+static inline void biasrun_options(biasrun &r,int &argc,char* argv[])
+{
+	r.nthread = sip_parse_threads(argc,argv);
+	r.resume = sip_parse_flag(argc,argv,"--resume");
+	r.streammode = sip_parse_flag(argc,argv,"--stream");
+	r.shard = sip_parse_value(argc,argv,"--shard",0);
+	r.extend = sip_parse_value(argc,argv,"--extend",0);
+	r.maskname = sip_parse_string(argc,argv,"--masks",NULL);
+}
+
+//running statistics of the keys finished so far
+static inline void biasrun_stat(biasrun &r,long long i)
+{
+	short fixed[64];
+	biaswriter_row(r.w,i,fixed);
+	if (r.groups==1) biasstat_add(r.st,fixed);
+	else biascond_add(r.c,i,fixed);
+}
+
+//program: name and operational parameters, for the checkpoint tag; name: output files without extension
+//false (with a message) if the run cannot start
+static inline bool biasrun_start(biasrun &r,const char* program,const char* name,int variant,int k,int n,int groups,long long keynum,long long inputnum,int interval)
+{
+	r.variant = variant;
+	r.k = k;
+	r.n = n;
+	r.groups = groups;
+	r.keynum = keynum;
+	r.inputnum = inputnum;
+	r.interval = interval;
+	r.seed = sip_rng_seed();
+	r.filename = std::string(name)+".txt";
+	r.binname = std::string(name)+".bin";
+	r.ckptname = r.filename+".ckpt";
+	//samples first..first+inputnum-1 of every message stream, added to the counters of base when extending a finished run
+	r.first = r.shard*inputnum;
+	if (r.extend>0)
+	{
+		if (!biaswriter_extend(r.base,r.binname.c_str(),variant,k,n,keynum))
+		{
+			printf("cannot extend %s\n",r.binname.c_str());
+			return false;
+		}
+		r.seed = r.base.head.seed;
+		r.first = r.base.head.first+r.base.head.inputnum;
+		r.inputnum = r.extend;
+	}
+	//checkpoint
+	char tag[200];
+	sprintf(tag,"%s inputnum=%lld keynum=%lld",program,r.inputnum,keynum/groups);
+	if (r.first>0) sprintf(tag+strlen(tag)," first=%lld",r.first);
+	sprintf(tag+strlen(tag)," output=%s",r.streammode?"stream":"text");  //a text file is never resumed from a --stream checkpoint
+	r.tag = tag;
+	r.cp.seed = r.seed;
+	r.cp.cursor = 0;
+	r.cp.offset = 0;
+	r.cp.count = 0;
+	if (r.resume&&sip_checkpoint_load(r.ckptname.c_str(),r.tag.c_str(),r.cp))
+	{
+		r.seed = r.cp.seed;
+		printf("resume from key %lld\n",r.cp.cursor);
+	}
+	printf("seed:%016llx\n",r.seed);
+	if (r.first>0) printf("samples:%lld~%lld\n",r.first,r.first+r.inputnum-1);
+	r.fout = NULL;
+	if (!r.streammode) r.fout = sip_checkpoint_open(r.filename.c_str(),r.cp.offset);
+	if ((!r.streammode)&&(r.fout==NULL))
+	{
+		printf("cannot write %s\n",r.filename.c_str());
+		if ((r.extend>0)&&(r.cp.cursor==0)) biaswriter_extend_abort(r.binname.c_str());
+		return false;
+	}
+	biaswriter_init(r.w,variant,k,n,groups,keynum,(r.extend>0)?r.base.head.inputnum+r.inputnum:r.inputnum);
+	biaswriter_counts(r.w,r.seed,(r.extend>0)?r.base.head.first:r.first);
+	if ((r.cp.cursor>0)&&!biaswriter_load(r.w,r.binname.c_str()))
+	{
+		printf("cannot resume %s\n",r.binname.c_str());
+		return false;
+	}
+	biasstat_init(r.st);
+	if (groups>1) biascond_init(r.c,groups,keynum);
+	for (long long i=0;r.streammode&&(i<r.cp.cursor);i++) biasrun_stat(r,i);
+	r.keylist.resize(keynum);
+	r.width = 64;
+	r.counter.assign(64*keynum,0);
+	r.last = time(0);
+	return true;
+}
+
+//option "--masks": every input mask against every output mask, written to prefix and the mask file name without its directory
+//false (with a message) if the run cannot start
+static inline bool biasrun_start_masks(biasrun &r,const char* prefix,long long keynum,long long inputnum)
+{
+	if (r.resume||r.streammode||(r.extend>0))
+	{
+		printf("option --masks only goes with -j and --shard\n");
+		return false;
+	}
+	if (!maskset_load(r.ms,r.maskname))
+	{
+		printf("cannot load masks from %s\n",r.maskname);
+		return false;
+	}
+	int nin = r.ms.inmask.size();
+	int nout = r.ms.outmask.size();
+	const char* stem = strrchr(r.maskname,'/');
+	r.filename = std::string(prefix)+((stem==NULL)?r.maskname:stem+1);
+	r.keynum = keynum;
+	r.inputnum = inputnum;
+	r.first = r.shard*inputnum;
+	r.seed = sip_rng_seed();
+	r.cp.cursor = 0;
+	printf("seed:%016llx\n",r.seed);
+	printf("masks:%d in %d out\n",nin,nout);
+	if (r.first>0) printf("samples:%lld~%lld\n",r.first,r.first+r.inputnum-1);
+	r.fout = fopen(r.filename.c_str(),"w");
+	if (r.fout==NULL)
+	{
+		printf("cannot write %s\n",r.filename.c_str());
+		return false;
+	}
+	r.keylist.resize(keynum);
+	r.width = nin*nout;
+	r.counter.assign((long long)r.width*keynum,0);
+	r.maxtime.assign(r.width,0);
+	r.sum.assign(r.width,0.0);
+	r.maxbias.assign(r.width,-100.0);
+	r.minbias.assign(r.width,0.0);
+	return true;
+}
+
+//--masks: key i into the file and the statistics of the pairs of masks
+static inline void biasrun_write_masks(biasrun &r,long long i)
+{
+	const long long* counter = &r.counter[(long long)r.width*i];
+	int nout = r.ms.outmask.size();
+	fprintf(r.fout,"%016llx\n",r.keylist[i].k0);
+	fprintf(r.fout,"%016llx\n",r.keylist[i].k1);
+	int maxsite_key = 0;
+	double maxbias_key = -100.0;
+	for (int p=0;p<r.width;p++)
+	{
+		double bias = biasstore_fixed(biasstore_bias_of(counter[p],r.inputnum))/100.0;
+		fprintf(r.fout,"%016llx %016llx %.2f\n",r.ms.inmask[p/nout],r.ms.outmask[p%nout],bias);
+		if (bias>maxbias_key)
+		{
+			maxbias_key = bias;
+			maxsite_key = p;
+		}
+		r.sum[p] += bias;
+		if (bias>r.maxbias[p]) r.maxbias[p] = bias;
+		if (bias<r.minbias[p]) r.minbias[p] = bias;
+	}
+	fprintf(r.fout,"\n");
+	r.maxtime[maxsite_key]++;
+}
+
+static inline void biasrun_finish_masks(biasrun &r)
+{
+	fclose(r.fout);
+	int nout = r.ms.outmask.size();
+	int best = 0;
+	for (int p=0;p<r.width;p++)
+	{
+		if (r.sum[p]>r.sum[best]) best = p;
+		if (r.maxtime[p]==0) continue;
+		printf("in:%016llx out:%016llx times:%d average:%.2f max:%.2f min:%.2f\n",r.ms.inmask[p/nout],r.ms.outmask[p%nout],r.maxtime[p],r.sum[p]/r.keynum,r.maxbias[p],r.minbias[p]);
+	}
+	printf("best average: in:%016llx out:%016llx average:%.2f\n",r.ms.inmask[best/nout],r.ms.outmask[best%nout],r.sum[best]/r.keynum);
+}
+
+//key i in key order: biases into the files (or the running statistics), and a checkpoint from time to time
+static inline void biasrun_write(biasrun &r,long long i)
+{
+	if (r.maskname!=NULL)
+	{
+		biasrun_write_masks(r,i);
+		return;
+	}
+	const long long* counter = &r.counter[64*i];
+	double bias[64];
+	for (int j=0;j<64;j++) bias[j] = biasstore_bias_of(counter[j],r.w.head.inputnum);
+	biaswriter_set(r.w,i,r.keylist[i].k0,r.keylist[i].k1,bias,counter);
+	if (r.streammode) biasrun_stat(r,i);
+	else
+	{
+		fprintf(r.fout,"%016llx\n",r.keylist[i].k0);
+		fprintf(r.fout,"%016llx\n",r.keylist[i].k1);
+		for (int j=0;j<64;j++) fprintf(r.fout,"%02d %.2f\n",j,bias[j]);
+		fprintf(r.fout,"\n");
+	}
+	if (sip_checkpoint_due(r.last,r.interval))
+	{
+		biaswriter_save(r.w,r.binname.c_str());
+		r.cp.cursor = i+1;
+		if (!r.streammode)
+		{
+			fflush(r.fout);
+			r.cp.offset = ftell(r.fout);
+		}
+		sip_checkpoint_save(r.ckptname.c_str(),r.tag.c_str(),r.cp);
+	}
+}
+
+//f(i,key,counter) for every unfinished key i, keys spread over the threads
+//  f sets key and adds to counter[0..r.width-1] (zero on entry) the output differences of messages r.first..r.first+r.inputnum-1
+template<typename F>
+static void biasrun_keys(biasrun &r,F f)
+{
+	sip_ordered ord(r.keynum,r.cp.cursor);
+	sip_parallel_for(r.nthread,r.cp.cursor,r.keynum,[&](long long keycount,int)
+	{
+		long long* counter = &r.counter[(long long)r.width*keycount];
+		f(keycount,r.keylist[keycount],counter);
+		if (r.extend>0)
+			for (int j=0;j<64;j++) counter[j] += r.base.count[j*r.base.head.keynum+keycount];
+		sip_ordered_done(ord,keycount,[&](long long i)
+		{
+			biasrun_write(r,i);
+		});
+	});
+}
+
+static inline void biasrun_finish(biasrun &r)
+{
+	if (r.maskname!=NULL)
+	{
+		biasrun_finish_masks(r);
+		return;
+	}
+	if (!r.streammode) fclose(r.fout);
+	r.w.head.complete = 1;
+	biaswriter_save(r.w,r.binname.c_str());
+	if (r.streammode)
+	{
+		if (r.groups==1) biasstat_print(r.st,stdout);
+		else biascond_print(r.c,r.n,stdout);
+	}
+	if (r.extend>0) biaswriter_extend_done(r.binname.c_str());
+	sip_checkpoint_remove(r.ckptname.c_str());
+}
+
+#endif
@@ -0,0 +1,367 @@
+/*
+	Bias Store - Binary Columnar Format for Generator Results
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	The text output of the generators (66 lines per key) is slow to parse for the analysis programs.
+	This header defines a binary file holding the same information, laid out by columns:
+		header  (64 bytes)      : magic "SIPBIAS1", variant, k, n, groups, keynum, inputnum, seed, first, counts, complete
+		keys    (keynum*16 bytes): k0,k1 of every key, in key order
+		columns (64*keynum*2 bytes): column j holds the bias of output bit j for every key, \
+		  as 16-bit fixed point (bias*100, exactly the two decimals of the text format)
+		counts  (64*keynum*8 bytes, only if counts = 1): the raw counters, column j holding for every key \
+		  the number of pairs whose output bit j differs
+	so the analysis of one output bit reads one contiguous column.
+	The generators also save the file at every checkpoint, with the keys not finished yet left at zero; \
+	  complete is only set when the last key is written, and only complete files can be merged or extended.
+	Files are loaded with mmap where available (read into memory otherwise), which takes milliseconds.
+	The generators always write the counts, together with the seed and the samples they cover: \
+	  messages first..first+inputnum-1 of every key's stream (siprng.h).
+	Two files with the same keys and adjacent samples can therefore be added up (bias_merge.cpp), \
+	  and a file can be extended with the next samples of the same streams; files converted from text have no counts.
+
+	Usage:
+		//generator
+		biaswriter w;
+		biaswriter_init(w,SIPBIAS_BIASTEST,k,-1,1,keynum,inputnum);
+		biaswriter_counts(w,seed,first);  //optional
+		biaswriter_set(w,keycount,key.k0,key.k1,bias,counter);  //bias[64], the values printed in the text file
+		w.head.complete = 1;  //after the last key
+		biaswriter_save(w,"sip21test_07.bin");
+		//analysis
+		biasstore st;
+		if (biasstore_open("./data/sip21test_07.bin",st)) x = biasstore_bias(st,j,i);  //output bit j of key i
+		biasstore_close(st);
+*/
+
+#ifndef BIASSTORE_H
+#define BIASSTORE_H
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<cmath>
+#include<string>
+#include<vector>
+#if defined(__unix__)||defined(__APPLE__)
+#define BIASSTORE_MMAP
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#endif
+
+enum {SIPBIAS_BIASTEST = 0,SIPBIAS_CONDTEST = 1,SIPBIAS_NEWCONDTEST = 2};
+
+struct biasheader
+{
+	char magic[8];  //"SIPBIAS1"
+	int variant;  //SIPBIAS_*
+	int k;  //input differential bit
+	int n;  //group tag of the condtest programs, -1 for the bias test
+	int groups;  //key groups in the file, keynum/groups keys each
+	long long keynum;  //keys in the file
+	long long inputnum;  //pairs per key
+	unsigned long long seed;  //seed of the keys and messages, if counts = 1
+	long long first;  //index of the first message in every key's stream, if counts = 1
+	int counts;  //1 if the raw counters follow the columns
+	int complete;  //1 once every key is written, 0 in the files saved at checkpoints
+};
+
+static inline size_t biasstore_size(long long keynum,int counts)
+{
+	return sizeof(biasheader)+keynum*16+64*keynum*2+(counts?64*keynum*8:0);
+}
+
+//exponential part of the bias of one output bit, as printed by the generators
+static inline double biasstore_bias_of(long long count,long long inputnum)
+{
+	double d = fabs(count-inputnum/2.0);
+	if (d==0) return -21;
+	return log(d)/log(2)-log((double)inputnum)/log(2);
+}
+
+//two decimals of the text format, e.g. -4.42 -> -442
+static inline short biasstore_fixed(double bias)
+{
+	char buf[32];
+	snprintf(buf,sizeof(buf),"%.2f",bias);
+	return (short)lround(atof(buf)*100);
+}
+
+struct biaswriter
+{
+	biasheader head;
+	std::vector<unsigned long long> key;
+	std::vector<short> column;
+	std::vector<long long> count;  //empty if there are no counts
+};
+
+static inline void biaswriter_init(biaswriter &w,int variant,int k,int n,int groups,long long keynum,long long inputnum)
+{
+	memset(&w.head,0,sizeof(biasheader));
+	memcpy(w.head.magic,"SIPBIAS1",8);
+	w.head.variant = variant;
+	w.head.k = k;
+	w.head.n = n;
+	w.head.groups = groups;
+	w.head.keynum = keynum;
+	w.head.inputnum = inputnum;
+	w.key.assign(2*keynum,0);
+	w.column.assign(64*keynum,0);
+	w.count.clear();
+}
+
+//keep the raw counters too, for samples first..first+inputnum-1 of the streams of seed
+static inline void biaswriter_counts(biaswriter &w,unsigned long long seed,long long first)
+{
+	w.head.seed = seed;
+	w.head.first = first;
+	w.head.counts = 1;
+	w.count.assign(64*w.head.keynum,0);
+}
+
+static inline void biaswriter_set(biaswriter &w,long long i,unsigned long long k0,unsigned long long k1,const double* bias,const long long* counter = NULL)
+{
+	w.key[2*i] = k0;
+	w.key[2*i+1] = k1;
+	for (int j=0;j<64;j++) w.column[j*w.head.keynum+i] = biasstore_fixed(bias[j]);
+	if ((counter!=NULL)&&w.head.counts)
+		for (int j=0;j<64;j++) w.count[j*w.head.keynum+i] = counter[j];
+}
+
+//bias*100 of the 64 output bits of key i
+static inline void biaswriter_row(const biaswriter &w,long long i,short* fixed)
+{
+	for (int j=0;j<64;j++) fixed[j] = w.column[j*w.head.keynum+i];
+}
+
+//written to a temporary file and renamed, so a reader never sees half a file
+static inline bool biaswriter_save(const biaswriter &w,const char* filename)
+{
+	std::string tmpname = std::string(filename)+".tmp";
+	FILE* fbin = fopen(tmpname.c_str(),"wb");
+	if (fbin==NULL) return false;
+	bool ok = (fwrite(&w.head,sizeof(biasheader),1,fbin)==1);
+	ok = ok&&(fwrite(w.key.data(),8,w.key.size(),fbin)==w.key.size());
+	ok = ok&&(fwrite(w.column.data(),2,w.column.size(),fbin)==w.column.size());
+	ok = ok&&(fwrite(w.count.data(),8,w.count.size(),fbin)==w.count.size());
+	if (fclose(fbin)!=0) ok = false;
+	return ok&&(rename(tmpname.c_str(),filename)==0);
+}
+
+struct biasstore
+{
+	const biasheader* head;
+	const unsigned long long* key;  //k0,k1 of key i at key[2*i],key[2*i+1]
+	const short* column;  //bias of output bit j of key i at column[j*keynum+i]
+	const long long* count;  //counter of output bit j of key i at count[j*keynum+i], NULL if there are no counts
+	void* base;
+	size_t size;
+	bool mapped;
+};
+
+static inline void biasstore_close(biasstore &st)
+{
+	if (st.base==NULL) return;
+#ifdef BIASSTORE_MMAP
+	if (st.mapped) munmap(st.base,st.size);
+	else free(st.base);
+#else
+	free(st.base);
+#endif
+	st.base = NULL;
+}
+
+static inline bool biasstore_check(biasstore &st)
+{
+	if (st.size<sizeof(biasheader)) return false;
+	st.head = (const biasheader*)st.base;
+	if (memcmp(st.head->magic,"SIPBIAS1",8)!=0) return false;
+	if ((st.head->counts!=0)&&(st.head->counts!=1)) return false;
+	if (st.size!=biasstore_size(st.head->keynum,st.head->counts)) return false;
+	st.key = (const unsigned long long*)((const char*)st.base+sizeof(biasheader));
+	st.column = (const short*)(st.key+2*st.head->keynum);
+	st.count = st.head->counts?(const long long*)(st.column+64*st.head->keynum):NULL;
+	return true;
+}
+
+//whole file into st.base (mapped where possible)
+static inline bool biasstore_map(const char* filename,biasstore &st)
+{
+	st.base = NULL;
+	st.size = 0;
+	st.mapped = false;
+#ifdef BIASSTORE_MMAP
+	int fd = open(filename,O_RDONLY);
+	if (fd<0) return false;
+	struct stat sb;
+	if ((fstat(fd,&sb)==0)&&(sb.st_size>0))
+	{
+		void* p = mmap(NULL,sb.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+		if (p!=MAP_FAILED)
+		{
+			st.base = p;
+			st.size = sb.st_size;
+			st.mapped = true;
+		}
+	}
+	close(fd);
+	if (st.base==NULL) return false;
+#else
+	FILE* fbin = fopen(filename,"rb");
+	if (fbin==NULL) return false;
+	fseek(fbin,0,SEEK_END);
+	st.size = ftell(fbin);
+	fseek(fbin,0,SEEK_SET);
+	st.base = malloc(st.size);
+	if ((st.base==NULL)||(fread(st.base,1,st.size,fbin)!=st.size))
+	{
+		fclose(fbin);
+		free(st.base);
+		st.base = NULL;
+		return false;
+	}
+	fclose(fbin);
+#endif
+	return true;
+}
+
+static inline bool biasstore_open(const char* filename,biasstore &st)
+{
+	if (!biasstore_map(filename,st)) return false;
+	if (!biasstore_check(st))
+	{
+		biasstore_close(st);
+		return false;
+	}
+	return true;
+}
+
+static inline double biasstore_bias(const biasstore &st,int j,long long i)
+{
+	return st.column[j*st.head->keynum+i]/100.0;
+}
+
+//back into a writer, e.g. to continue a resumed run
+static inline bool biaswriter_load(biaswriter &w,const char* filename)
+{
+	biasstore st;
+	if (!biasstore_open(filename,st)) return false;
+	w.head = *st.head;
+	w.key.assign(st.key,st.key+2*st.head->keynum);
+	w.column.assign(st.column,st.column+64*st.head->keynum);
+	if (st.count!=NULL) w.count.assign(st.count,st.count+64*st.head->keynum);
+	else w.count.clear();
+	biasstore_close(st);
+	return true;
+}
+
+//one bias of the text format, e.g. "-4.42" -> -442, p moved past it; false if there is none
+static inline bool biasstore_parse_fixed(const char* &p,const char* end,short &fixed)
+{
+	while ((p<end)&&((*p==' ')||(*p=='\n')||(*p=='\r')||(*p=='\t'))) p++;
+	const char* start = p;
+	bool minus = (p<end)&&(*p=='-');
+	if (minus) p++;
+	long long v = 0;
+	int digits = 0,decimals = -1;
+	for (;p<end;p++)
+	{
+		if ((*p>='0')&&(*p<='9'))
+		{
+			v = 10*v+(*p-'0');
+			digits++;
+			if (decimals>=0) decimals++;
+		}
+		else if ((*p=='.')&&(decimals<0)) decimals = 0;
+		else break;
+	}
+	if (digits==0) return false;
+	if (decimals==2) fixed = (short)(minus?-v:v);
+	else if ((decimals<0)&&(v<300)) fixed = (short)(minus?-100*v:100*v);  //integer, e.g. the output bit
+	else
+	{
+		char buf[32];  //any other number of decimals, through the slow path
+		int len = (p-start<31)?(int)(p-start):31;
+		memcpy(buf,start,len);
+		buf[len] = '\0';
+		fixed = biasstore_fixed(atof(buf));
+	}
+	return true;
+}
+
+//one hexadecimal key word of the text format
+static inline bool biasstore_parse_hex(const char* &p,const char* end,unsigned long long &a)
+{
+	while ((p<end)&&((*p==' ')||(*p=='\n')||(*p=='\r')||(*p=='\t'))) p++;
+	a = 0;
+	int digits = 0;
+	for (;p<end;p++,digits++)
+	{
+		if ((*p>='0')&&(*p<='9')) a = 16*a+(*p-'0');
+		else if ((*p>='a')&&(*p<='f')) a = 16*a+(*p-'a'+10);
+		else if ((*p>='A')&&(*p<='F')) a = 16*a+(*p-'A'+10);
+		else break;
+	}
+	return digits>0;
+}
+
+//text output of a generator into a writer (without counts), parsed in place from the mapped file; false if the file is missing or malformed
+static inline bool biaswriter_parse_text(biaswriter &w,const char* filename,int variant,int k,int n,int groups,long long inputnum)
+{
+	biasstore st;
+	if (!biasstore_map(filename,st)) return false;
+	const char* p = (const char*)st.base;
+	const char* end = p+st.size;
+	std::vector<unsigned long long> key;
+	std::vector<short> row;  //64 biases per key
+	bool ok = true;
+	unsigned long long k0,k1;
+	while (ok&&biasstore_parse_hex(p,end,k0))
+	{
+		ok = biasstore_parse_hex(p,end,k1);
+		key.push_back(k0);
+		key.push_back(k1);
+		for (int j=0;ok&&(j<64);j++)
+		{
+			short site,fixed;
+			ok = biasstore_parse_fixed(p,end,site)&&(site==100*j)&&biasstore_parse_fixed(p,end,fixed);
+			row.push_back(fixed);
+		}
+	}
+	biasstore_close(st);
+	if (!ok) return false;
+	long long keynum = key.size()/2;
+	biaswriter_init(w,variant,k,n,groups,keynum,inputnum);
+	w.key = key;
+	for (long long i=0;i<keynum;i++)
+		for (int j=0;j<64;j++) w.column[j*keynum+i] = row[64*i+j];
+	return true;
+}
+
+//extension of the finished run in binname by more samples: its file is kept aside as binname.base until the extension completes,
+//  so an interrupted extension is started again (or resumed) from the same base
+//false if the run is not a finished run (complete) of these parameters with raw counters, the files are then left as they were
+static inline bool biaswriter_extend(biaswriter &base,const char* binname,int variant,int k,int n,long long keynum)
+{
+	std::string basename = std::string(binname)+".base";
+	FILE* fbase = fopen(basename.c_str(),"rb");
+	bool interrupted = (fbase!=NULL);
+	if (interrupted) fclose(fbase);
+	if (!biaswriter_load(base,interrupted?basename.c_str():binname)) return false;
+	if ((base.head.complete!=1)||(base.head.counts!=1)||(base.head.variant!=variant)||(base.head.k!=k)||(base.head.n!=n)||(base.head.keynum!=keynum)) return false;
+	return interrupted||(rename(binname,basename.c_str())==0);
+}
+
+//puts the base back as binname, for an extension stopped before its first checkpoint
+static inline void biaswriter_extend_abort(const char* binname)
+{
+	rename((std::string(binname)+".base").c_str(),binname);
+}
+
+static inline void biaswriter_extend_done(const char* binname)
+{
+	remove((std::string(binname)+".base").c_str());
+}
+
+#endif
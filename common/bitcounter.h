@@ -0,0 +1,127 @@
+/*
+	Column Counter - Vertical Accumulation of 64 Per-Bit Counters
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This header replaces the per-pair loop
+		for (int j=0;j<64;j++) if (get_pos_i(diffrence,j)==1) counter[j]++;
+	which costs 64 branches per pair.
+	The counts are kept vertically, bit i of the count of column j being bit j of one 64-bit word, so one word is added with a few AND/XOR:
+		16 words at a time are reduced with a Harley-Seal carry-save tree into ones/twos/fours/eights and one sixteens word,
+		sixteens words are ripple-added into 16 bit-planes of weight 16,
+		the bit-planes are flushed into the wide counters before they can overflow (every 2^16-1 sixteens words).
+
+	Usage:
+		bitcounter bc;
+		bitcounter_init(bc);
+		bitcounter_add(bc,diffrence,num);  //any number of times
+		bitcounter_flush(bc,counter);  //counter[j] += number of added words with bit j set
+*/
+
+#ifndef BITCOUNTER_H
+#define BITCOUNTER_H
+
+const int bitcounter_planes = 16;
+
+struct bitcounter
+{
+	unsigned long long ones,twos,fours,eights;  //carry-save columns of weight 1,2,4,8
+	unsigned long long plane[bitcounter_planes];  //ripple columns of weight 16,32,...
+	long long planecount;  //sixteens words in plane[] since the last flush
+	long long count[64];  //wide counters
+};
+
+static inline void bitcounter_csa(unsigned long long &h,unsigned long long &l,unsigned long long a,unsigned long long b,unsigned long long c)  //carry-save adder
+{
+	unsigned long long u = a^b;
+	h = (a&b)|(u&c);
+	l = u^c;
+}
+
+static inline void bitcounter_init(bitcounter &bc)
+{
+	bc.ones = bc.twos = bc.fours = bc.eights = 0;
+	for (int i=0;i<bitcounter_planes;i++) bc.plane[i] = 0;
+	bc.planecount = 0;
+	for (int j=0;j<64;j++) bc.count[j] = 0;
+}
+
+//move plane[] into count[]
+static inline void bitcounter_flush_planes(bitcounter &bc)
+{
+	for (int i=0;i<bitcounter_planes;i++)
+	{
+		unsigned long long a = bc.plane[i];
+		while (a)
+		{
+			bc.count[__builtin_ctzll(a)] += 16LL<<i;
+			a &= a-1;
+		}
+		bc.plane[i] = 0;
+	}
+	bc.planecount = 0;
+}
+
+static inline void bitcounter_add_sixteens(bitcounter &bc,unsigned long long carry)
+{
+	for (int i=0;(i<bitcounter_planes)&&carry;i++)
+	{
+		unsigned long long t = bc.plane[i]&carry;
+		bc.plane[i] ^= carry;
+		carry = t;
+	}
+	bc.planecount++;
+	if (bc.planecount==(1LL<<bitcounter_planes)-1) bitcounter_flush_planes(bc);
+}
+
+static inline void bitcounter_add(bitcounter &bc,unsigned long long a)
+{
+	unsigned long long carry = bc.ones&a;
+	bc.ones ^= a;
+	unsigned long long t = bc.twos&carry;
+	bc.twos ^= carry;
+	carry = bc.fours&t;
+	bc.fours ^= t;
+	t = bc.eights&carry;
+	bc.eights ^= carry;
+	if (t) bitcounter_add_sixteens(bc,t);
+}
+
+static inline void bitcounter_add(bitcounter &bc,const unsigned long long* a,long long n)
+{
+	long long i = 0;
+	for (;i+16<=n;i+=16)
+	{
+		unsigned long long twosA,twosB,foursA,foursB,eightsA,eightsB,sixteens;
+		bitcounter_csa(twosA,bc.ones,bc.ones,a[i],a[i+1]);
+		bitcounter_csa(twosB,bc.ones,bc.ones,a[i+2],a[i+3]);
+		bitcounter_csa(foursA,bc.twos,bc.twos,twosA,twosB);
+		bitcounter_csa(twosA,bc.ones,bc.ones,a[i+4],a[i+5]);
+		bitcounter_csa(twosB,bc.ones,bc.ones,a[i+6],a[i+7]);
+		bitcounter_csa(foursB,bc.twos,bc.twos,twosA,twosB);
+		bitcounter_csa(eightsA,bc.fours,bc.fours,foursA,foursB);
+		bitcounter_csa(twosA,bc.ones,bc.ones,a[i+8],a[i+9]);
+		bitcounter_csa(twosB,bc.ones,bc.ones,a[i+10],a[i+11]);
+		bitcounter_csa(foursA,bc.twos,bc.twos,twosA,twosB);
+		bitcounter_csa(twosA,bc.ones,bc.ones,a[i+12],a[i+13]);
+		bitcounter_csa(twosB,bc.ones,bc.ones,a[i+14],a[i+15]);
+		bitcounter_csa(foursB,bc.twos,bc.twos,twosA,twosB);
+		bitcounter_csa(eightsB,bc.fours,bc.fours,foursA,foursB);
+		bitcounter_csa(sixteens,bc.eights,bc.eights,eightsA,eightsB);
+		bitcounter_add_sixteens(bc,sixteens);
+	}
+	for (;i<n;i++) bitcounter_add(bc,a[i]);
+}
+
+//counter[j] += column j of everything added since the last flush, then start again from 0
+static inline void bitcounter_flush(bitcounter &bc,long long* counter)
+{
+	bitcounter_flush_planes(bc);
+	for (int j=0;j<64;j++)
+	{
+		long long low = ((bc.ones>>j)&1)+2*((bc.twos>>j)&1)+4*((bc.fours>>j)&1)+8*((bc.eights>>j)&1);
+		counter[j] += bc.count[j]+low;
+	}
+	bitcounter_init(bc);
+}
+
+#endif
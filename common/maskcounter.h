@@ -0,0 +1,143 @@
+/*
+	Mask Counter - Many Input Differences and Output Parities over One Batch of Messages
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This header generalizes the pair counting of siphash_simd.h from one input bit and single output bits \
+	  to lists of input masks (any 64-bit input difference) and output masks (the parity of the output difference on the mask):
+		counter[a*nout+b] = pairs (m, m^inmask[a]) with popcount((output(m)^output(m^inmask[a]))&outmask[b]) odd
+	A single-bit output mask 1<<j gives the counter of output bit j, as counted by the generators.
+	Every batch of base messages is hashed once, and only the messages m^inmask[a] are hashed again for each input mask.
+	The output differences of 64 pairs are transposed into 64 bit-columns, column j holding bit j of the 64 differences, \
+	  so the parities of the 64 pairs on one output mask are the XOR of the columns in the mask, and are counted with one popcount.
+	The transposition is shared by all output masks, and an output mask of w bits costs w XOR per 64 pairs, \
+	  so scanning hundreds of sparse output masks costs about as much as hashing the pairs once more.
+
+	Mask files list one mask per line, "in" or "out" followed by the mask in hex; empty lines and lines starting with '#' are skipped.
+	i.e.:
+		# input bit 7, output bits 17 and 33, and their parity
+		in 0000000000000080
+		out 0000000000020000
+		out 0000000200000000
+		out 0000000200020000
+
+	Usage:
+		maskset ms;
+		maskset_load(ms,"masks.txt");  //or maskset_add(ms,true,inmask), maskset_add(ms,false,outmask)
+		long long* counter = new long long[ms.inmask.size()*ms.outmask.size()]();
+		sipctx ctx = sip_prepare(key);
+		siphash_cd_mask_count<2,1>(ctx,ms,message,inputnum,counter);  //any number of times
+*/
+
+#ifndef MASKCOUNTER_H
+#define MASKCOUNTER_H
+
+#include<cstdio>
+#include<cstring>
+#include<vector>
+#include"siphash_simd.h"
+
+const int maskcounter_batch = 256;  //pairs hashed at a time for each input mask
+
+struct maskset
+{
+	std::vector<unsigned long long> inmask,outmask;
+	std::vector<int> outbit;  //bits of output mask b at outbit[outfirst[b]..outfirst[b+1]-1]
+	std::vector<int> outfirst;
+};
+
+static inline void maskset_add(maskset &ms,bool in,unsigned long long mask)
+{
+	if (in)
+	{
+		ms.inmask.push_back(mask);
+		return;
+	}
+	if (ms.outfirst.empty()) ms.outfirst.push_back(0);
+	ms.outmask.push_back(mask);
+	for (int j=0;j<64;j++)
+		if ((mask>>j)&1) ms.outbit.push_back(j);
+	ms.outfirst.push_back(ms.outbit.size());
+}
+
+//false if the file cannot be read, has a line it does not understand, or lacks input or output masks
+static inline bool maskset_load(maskset &ms,const char* filename)
+{
+	FILE* fin = fopen(filename,"r");
+	if (fin==NULL) return false;
+	char line[256];
+	bool ok = true;
+	while (ok&&(fgets(line,sizeof(line),fin)!=NULL))
+	{
+		char kind[8];
+		unsigned long long mask;
+		line[strcspn(line,"\r\n")] = '\0';
+		if ((line[0]=='\0')||(line[0]=='#')) continue;
+		ok = (sscanf(line,"%7s %llx",kind,&mask)==2)&&((strcmp(kind,"in")==0)||(strcmp(kind,"out")==0));
+		if (ok) maskset_add(ms,strcmp(kind,"in")==0,mask);
+		else fprintf(stderr,"%s: cannot read \"%s\"\n",filename,line);
+	}
+	fclose(fin);
+	return ok&&!ms.inmask.empty()&&!ms.outmask.empty();
+}
+
+//a[j] bit i = a[i] bit j
+static inline void maskcounter_transpose(unsigned long long* a)
+{
+	unsigned long long m = 0x00000000ffffffffULL;
+	for (int j=32;j!=0;j>>=1,m^=(m<<j))
+		for (int k=0;k<64;k=((k|j)+1)&~j)
+		{
+			unsigned long long t = ((a[k]>>j)^a[k|j])&m;
+			a[k] ^= t<<j;
+			a[k|j] ^= t;
+		}
+}
+
+//counter[b] += differences among diffrence[0..n-1] (n <= 64) with odd parity on output mask b
+static inline void maskcounter_add(const maskset &ms,const unsigned long long* diffrence,int n,long long* counter)
+{
+	unsigned long long column[64];
+	for (int i=0;i<n;i++) column[i] = diffrence[i];
+	for (int i=n;i<64;i++) column[i] = 0;
+	maskcounter_transpose(column);
+	int nout = ms.outmask.size();
+	for (int b=0;b<nout;b++)
+	{
+		unsigned long long parity = 0;
+		for (int t=ms.outfirst[b];t<ms.outfirst[b+1];t++) parity ^= column[ms.outbit[t]];
+		counter[b] += __builtin_popcountll(parity);
+	}
+}
+
+//counter[a*nout+b] += pairs (m[i], m[i]^inmask[a]) whose output difference has odd parity on outmask[b]
+template<int C,int D>
+static inline void siphash_cd_mask_count(const sipctx &ctx,const maskset &ms,const unsigned long long* m,long long n,long long* counter)
+{
+	unsigned long long base[maskcounter_batch],message[maskcounter_batch],diffrence[maskcounter_batch];
+	int nin = ms.inmask.size();
+	int nout = ms.outmask.size();
+	for (long long first=0;first<n;first+=maskcounter_batch)
+	{
+		int num = maskcounter_batch;
+		if (n-first<num) num = n-first;
+		siphash_cd_batch<C,D>(ctx,m+first,base,num);
+		for (int a=0;a<nin;a++)
+		{
+			for (int i=0;i<num;i++) message[i] = m[first+i]^ms.inmask[a];
+			siphash_cd_batch<C,D>(ctx,message,diffrence,num);
+			for (int i=0;i<num;i++) diffrence[i] ^= base[i];
+			for (int i=0;i<num;i+=64) maskcounter_add(ms,diffrence+i,(num-i<64)?num-i:64,counter+a*nout);
+		}
+	}
+}
+
+static inline void siphash_2_1_mask_count(const sipctx &ctx,const maskset &ms,const unsigned long long* m,long long n,long long* counter)
+{
+	siphash_cd_mask_count<2,1>(ctx,ms,m,n,counter);
+}
+static inline void siphash_2_2_mask_count(const sipctx &ctx,const maskset &ms,const unsigned long long* m,long long n,long long* counter)
+{
+	siphash_cd_mask_count<2,2>(ctx,ms,m,n,counter);
+}
+
+#endif
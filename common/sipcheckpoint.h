@@ -0,0 +1,139 @@
+/*
+	Checkpoint - Resume Long Data Generation Runs
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	Every key (or chunk of samples) is a pure function of the seed and its index (see siprng.h), \
+	  so the whole state of a run is the seed, the index of the first unfinished key/chunk (cursor), \
+	  the length of the output file written so far (offset), and for single-key runs the count accumulated so far (count).
+	The checkpoint is a small text file next to the output file, rewritten atomically (written to a temporary file, then renamed), \
+	  together with a tag describing the run (program and internal parameters), so that a run is never resumed under different parameters.
+
+	Usage:
+		bool resume = sip_parse_flag(argc,argv,"--resume");
+		sipcheckpoint cp;
+		if (resume&&sip_checkpoint_load(ckptname,tag,cp)) seed = cp.seed;  //and start from cp.cursor
+		FILE* fout = sip_checkpoint_open(filename,cp.offset);
+		...
+		if (sip_checkpoint_due(last,checkpointinterval)) sip_checkpoint_save(ckptname,tag,cp);  //from time to time
+		sip_checkpoint_remove(ckptname);  //when the run is complete
+*/
+
+#ifndef SIPCHECKPOINT_H
+#define SIPCHECKPOINT_H
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<ctime>
+#include<string>
+#include<filesystem>
+
+struct sipcheckpoint
+{
+	unsigned long long seed;
+	long long cursor;  //first unfinished key or chunk
+	long long offset;  //bytes of the output file belonging to finished keys
+	long long count;  //counter accumulated over finished chunks
+};
+
+//removes the flag from the operational parameters and tells whether it was there
+static inline bool sip_parse_flag(int &argc,char* argv[],const char* flag)
+{
+	for (int i=1;i<argc;i++)
+		if (strcmp(argv[i],flag)==0)
+		{
+			for (int j=i;j<argc;j++) argv[j] = argv[j+1];
+			argc--;
+			return true;
+		}
+	return false;
+}
+
+//removes "flag value" from the operational parameters and returns the value, def if the flag is not there
+static inline long long sip_parse_value(int &argc,char* argv[],const char* flag,long long def)
+{
+	for (int i=1;i+1<argc;i++)
+		if (strcmp(argv[i],flag)==0)
+		{
+			long long value = atoll(argv[i+1]);
+			for (int j=i;j+2<=argc;j++) argv[j] = argv[j+2];
+			argc -= 2;
+			return value;
+		}
+	return def;
+}
+
+//removes "flag value" from the operational parameters and returns the value (e.g. a file name), def if the flag is not there
+static inline const char* sip_parse_string(int &argc,char* argv[],const char* flag,const char* def)
+{
+	for (int i=1;i+1<argc;i++)
+		if (strcmp(argv[i],flag)==0)
+		{
+			const char* value = argv[i+1];
+			for (int j=i;j+2<=argc;j++) argv[j] = argv[j+2];
+			argc -= 2;
+			return value;
+		}
+	return def;
+}
+
+static inline void sip_checkpoint_save(const char* filename,const char* tag,const sipcheckpoint &cp)
+{
+	std::string tmpname = std::string(filename)+".tmp";
+	FILE* fckpt = fopen(tmpname.c_str(),"w");
+	if (fckpt==NULL) return;
+	fprintf(fckpt,"%s\n",tag);
+	fprintf(fckpt,"seed %016llx\n",cp.seed);
+	fprintf(fckpt,"cursor %lld\n",cp.cursor);
+	fprintf(fckpt,"offset %lld\n",cp.offset);
+	fprintf(fckpt,"count %lld\n",cp.count);
+	fclose(fckpt);
+	rename(tmpname.c_str(),filename);
+}
+
+//false if there is no checkpoint, or it belongs to a run with another tag
+static inline bool sip_checkpoint_load(const char* filename,const char* tag,sipcheckpoint &cp)
+{
+	FILE* fckpt = fopen(filename,"r");
+	if (fckpt==NULL) return false;
+	char line[256];
+	bool ok = (fgets(line,sizeof(line),fckpt)!=NULL);
+	if (ok)
+	{
+		line[strcspn(line,"\r\n")] = '\0';
+		ok = (strcmp(line,tag)==0);
+		if (!ok) fprintf(stderr,"checkpoint %s belongs to another run: %s\n",filename,line);
+	}
+	sipcheckpoint t;
+	if (ok) ok = (fscanf(fckpt," seed %llx cursor %lld offset %lld count %lld",&t.seed,&t.cursor,&t.offset,&t.count)==4);
+	fclose(fckpt);
+	if (ok) cp = t;
+	return ok;
+}
+
+//output file of a run: new if offset = 0, otherwise cut back to the first offset bytes (dropping keys written after the checkpoint) and appended to
+static inline FILE* sip_checkpoint_open(const char* filename,long long offset)
+{
+	if (offset==0) return fopen(filename,"w");
+	std::error_code ec;
+	if ((long long)std::filesystem::file_size(filename,ec)<offset) return NULL;
+	std::filesystem::resize_file(filename,offset,ec);
+	if (ec) return NULL;
+	return fopen(filename,"a");
+}
+
+static inline void sip_checkpoint_remove(const char* filename)
+{
+	remove(filename);
+}
+
+//true (and restarts the clock) once every interval seconds
+static inline bool sip_checkpoint_due(time_t &last,int interval)
+{
+	time_t now = time(0);
+	if (now-last<interval) return false;
+	last = now;
+	return true;
+}
+
+#endif
@@ -0,0 +1,369 @@
+/*
+	Reduced-Round SipHash - Shared Engine
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This header provides the SipHash-c-d kernel shared by all data generation and key recovery programs.
+	The whole state is kept in local variables and the key is passed by value, \
+	  so the compiler is free to keep everything in registers and several threads can hash under different keys at the same time.
+	The data generation and key recovery programs restrict input messages into one 64-bit block, same as in the article:
+		v3 ^= m, c SipRounds, v0 ^= m, v2 ^= 0xff, d SipRounds, output v0^v1^v2^v3
+
+	Since the message only enters through v3, the key initialization and the v0/v1 half of the first SipRound \
+	  (v0 += v1, v1 <<<= 13, v1 ^= v0, v0 <<<= 32) are the same for every message under a fixed key.
+	sip_prepare() computes this prefix once per key into a sipctx, and siphash_cd_ctx() hashes from it.
+	Messages of any length are hashed as in the SipHash specification: a message of len bytes is cut into len/8 blocks \
+	  of 8 bytes (little-endian), followed by one last block holding the len%8 remaining bytes and len mod 256 in its most significant byte, \
+	  and every block goes through v3 ^= m, c SipRounds, v0 ^= m before the finalization.
+	The single-block functions are the case of a last block given directly, e.g. sip_pad(m,7) for the 7-byte messages of the recovery programs.
+	sip_prepare_prefix() absorbs some first blocks into the sipctx, \
+	  so that every function starting from a sipctx hashes the next block(s) of messages sharing these first blocks \
+	  (e.g. differentials on the second or last block, with siphash_cd_pair() or the batch kernels of siphash_simd.h).
+
+	Usage:
+		sipkey key = {k0,k1};
+		unsigned long long output = siphash_cd<2,1>(key,message);
+		unsigned long long output = siphash_2_1(key,message);
+		sipctx ctx = sip_prepare(key);  //once per key
+		unsigned long long output = siphash_2_1(ctx,message);
+		unsigned long long diffrence = siphash_2_1_pair(ctx,message,1ULL<<k);  //output(message)^output(message^(1<<k))
+		unsigned long long output = siphash_cd_bytes<2,4>(key,data,len);  //len bytes at data, padding included
+		sipctx ctx1 = sip_prepare_prefix<2>(key,block,1);  //first block fixed
+		unsigned long long diffrence = siphash_2_1_pair(ctx1,sip_pad(last,15),1ULL<<k);  //on the last block of 15-byte messages
+*/
+
+#ifndef SIPHASH_H
+#define SIPHASH_H
+
+#include<cstring>
+
+//initialization constants "somepseudorandomlygeneratedbytes"
+const unsigned long long sip_h[4] = {0x736f6d6570736575,0x646f72616e646f6d,0x6c7967656e657261,0x7465646279746573};
+const unsigned long long sip_ff = 0x00000000000000ff;
+
+struct sipkey
+{
+	unsigned long long k0,k1;
+};
+
+struct sipstate
+{
+	unsigned long long v0,v1,v2,v3;
+};
+
+static inline unsigned long long sip_rotl(unsigned long long a,int length)  //64-bit left-rotate
+{
+	return ((a<<length)|(a>>(64-length)));
+}
+
+static inline sipstate sip_init(sipkey key)
+{
+	sipstate s;
+	s.v0 = sip_h[0]^key.k0;
+	s.v1 = sip_h[1]^key.k1;
+	s.v2 = sip_h[2]^key.k0;
+	s.v3 = sip_h[3]^key.k1;
+	return s;
+}
+
+static inline void SipRound(sipstate &s)
+{
+	s.v0 = s.v0+s.v1;
+	s.v2 = s.v2+s.v3;
+	s.v1 = sip_rotl(s.v1,13);
+	s.v3 = sip_rotl(s.v3,16);
+	s.v1 = s.v0^s.v1;
+	s.v3 = s.v2^s.v3;
+	s.v0 = sip_rotl(s.v0,32);
+	//halfround
+	s.v2 = s.v1+s.v2;
+	s.v0 = s.v0+s.v3;
+	s.v1 = sip_rotl(s.v1,17);
+	s.v3 = sip_rotl(s.v3,21);
+	s.v1 = s.v1^s.v2;
+	s.v3 = s.v0^s.v3;
+	s.v2 = sip_rotl(s.v2,32);
+}
+
+//keyed context: v0,v1 after the message-independent half of the first SipRound, v2,v3 right after initialization
+struct sipctx
+{
+	sipstate s;
+};
+
+//keyed context of the state s before the next block
+static inline sipctx sip_prepare_state(sipstate s)
+{
+	sipctx ctx;
+	ctx.s = s;
+	ctx.s.v0 = ctx.s.v0+ctx.s.v1;
+	ctx.s.v1 = sip_rotl(ctx.s.v1,13);
+	ctx.s.v1 = ctx.s.v0^ctx.s.v1;
+	ctx.s.v0 = sip_rotl(ctx.s.v0,32);
+	return ctx;
+}
+static inline sipctx sip_prepare(sipkey key)
+{
+	return sip_prepare_state(sip_init(key));
+}
+
+template<int R>
+static inline void SipRounds(sipstate &s)
+{
+	for (int i=0;i<R;i++) SipRound(s);
+}
+
+//last SipRound fused with the output v0^v1^v2^v3
+//after the last halfround v3 = (v3<<<21)^v0, so v0 cancels in the output and the v0 lane is never updated
+static inline unsigned long long SipRound_output(sipstate &s)
+{
+	s.v0 = s.v0+s.v1;
+	s.v2 = s.v2+s.v3;
+	s.v1 = sip_rotl(s.v1,13);
+	s.v3 = sip_rotl(s.v3,16);
+	s.v1 = s.v0^s.v1;
+	s.v3 = s.v2^s.v3;
+	//halfround
+	s.v2 = s.v1+s.v2;
+	return sip_rotl(s.v1,17)^sip_rotl(s.v3,21)^s.v2^sip_rotl(s.v2,32);
+}
+template<int D>
+static inline unsigned long long SipRounds_output(sipstate &s)
+{
+	if (D==0) return (s.v0^s.v1^s.v2^s.v3);
+	SipRounds<D-1>(s);
+	return SipRound_output(s);
+}
+
+template<int C,int D>
+static inline unsigned long long siphash_cd(sipkey key,unsigned long long m)
+{
+	sipstate s = sip_init(key);
+	//c-round compression
+	s.v3 = s.v3^m;
+	SipRounds<C>(s);
+	s.v0 = s.v0^m;
+	//d-round finalization
+	s.v2 = s.v2^sip_ff;
+	return SipRounds_output<D>(s);
+}
+
+//state after the c-round compression of block m, starting from the keyed context
+template<int C>
+static inline sipstate SipCompress_ctx(const sipctx &ctx,unsigned long long m)
+{
+	sipstate s = ctx.s;
+	//c-round compression, starting from the v2/v3 half of the first SipRound
+	s.v3 = s.v3^m;
+	s.v2 = s.v2+s.v3;
+	s.v3 = sip_rotl(s.v3,16);
+	s.v3 = s.v2^s.v3;
+	//halfround
+	s.v2 = s.v1+s.v2;
+	s.v0 = s.v0+s.v3;
+	s.v1 = sip_rotl(s.v1,17);
+	s.v3 = sip_rotl(s.v3,21);
+	s.v1 = s.v1^s.v2;
+	s.v3 = s.v0^s.v3;
+	s.v2 = sip_rotl(s.v2,32);
+	SipRounds<C-1>(s);
+	s.v0 = s.v0^m;
+	return s;
+}
+template<int C>
+static inline void SipCompress(sipstate &s,unsigned long long m)
+{
+	s.v3 = s.v3^m;
+	SipRounds<C>(s);
+	s.v0 = s.v0^m;
+}
+//d-round finalization
+template<int D>
+static inline unsigned long long SipFinalize(sipstate &s)
+{
+	s.v2 = s.v2^sip_ff;
+	return SipRounds_output<D>(s);
+}
+
+template<int C,int D>
+static inline unsigned long long siphash_cd_ctx(const sipctx &ctx,unsigned long long m)
+{
+	sipstate s = SipCompress_ctx<C>(ctx,m);
+	return SipFinalize<D>(s);
+}
+
+//multi-block messages
+//last block of a message of len bytes, whose len%8 remaining bytes are the low bytes of tail
+static inline unsigned long long sip_pad(unsigned long long tail,long long len)
+{
+	int r = len&7;
+	if (r>0) tail = tail&((~0ULL)>>(64-8*r));
+	else tail = 0;
+	return tail|((unsigned long long)(len&0xff)<<56);
+}
+//n <= 8 bytes, little-endian
+static inline unsigned long long sip_load(const unsigned char* p,int n)
+{
+	unsigned long long a = 0;
+#if defined(__BYTE_ORDER__)&&(__BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__)
+	if (n==8)
+	{
+		memcpy(&a,p,8);
+		return a;
+	}
+#endif
+	switch (n)
+	{
+		case 7: a = a|((unsigned long long)p[6]<<48); [[fallthrough]];
+		case 6: a = a|((unsigned long long)p[5]<<40); [[fallthrough]];
+		case 5: a = a|((unsigned long long)p[4]<<32); [[fallthrough]];
+		case 4: a = a|((unsigned long long)p[3]<<24); [[fallthrough]];
+		case 3: a = a|((unsigned long long)p[2]<<16); [[fallthrough]];
+		case 2: a = a|((unsigned long long)p[1]<<8); [[fallthrough]];
+		case 1: a = a|p[0]; break;
+		case 8:
+			for (int i=0;i<8;i++) a = a|((unsigned long long)p[i]<<(8*i));
+	}
+	return a;
+}
+static inline long long sip_blocknum(long long len)
+{
+	return len/8+1;
+}
+//block[0..len/8] = blocks of the message of len bytes at data, the last one padded; returns the number of blocks
+static inline long long sip_blocks(const unsigned char* data,long long len,unsigned long long* block)
+{
+	long long w = len/8;
+	for (long long b=0;b<w;b++) block[b] = sip_load(data+8*b,8);
+	block[w] = sip_pad(sip_load(data+8*w,len&7),len);
+	return w+1;
+}
+//keyed context after the first blocks block[0..nprefix-1], for messages sharing them
+template<int C>
+static inline sipctx sip_prepare_prefix(sipkey key,const unsigned long long* block,long long nprefix)
+{
+	sipstate s = sip_init(key);
+	for (long long b=0;b<nprefix;b++) SipCompress<C>(s,block[b]);
+	return sip_prepare_state(s);
+}
+//output of the blocks block[0..nblock-1] (nblock >= 1, padding included), after the blocks of the context
+template<int C,int D>
+static inline unsigned long long siphash_cd_blocks(const sipctx &ctx,const unsigned long long* block,long long nblock)
+{
+	sipstate s = SipCompress_ctx<C>(ctx,block[0]);
+	for (long long b=1;b<nblock;b++) SipCompress<C>(s,block[b]);
+	return SipFinalize<D>(s);
+}
+//output of the message of len bytes at data, blocks read on the fly
+template<int C,int D>
+static inline unsigned long long siphash_cd_bytes(const sipctx &ctx,const unsigned char* data,long long len)
+{
+	long long w = len/8;
+	unsigned long long last = sip_pad(sip_load(data+8*w,len&7),len);
+	sipstate s = SipCompress_ctx<C>(ctx,(w>0)?sip_load(data,8):last);
+	for (long long b=1;b<w;b++) SipCompress<C>(s,sip_load(data+8*b,8));
+	if (w>0) SipCompress<C>(s,last);
+	return SipFinalize<D>(s);
+}
+template<int C,int D>
+static inline unsigned long long siphash_cd_bytes(sipkey key,const unsigned char* data,long long len)
+{
+	return siphash_cd_bytes<C,D>(sip_prepare(key),data,len);
+}
+
+//the two members of the pair (m,m^delta) hashed side by side, returning only the output difference:
+//the two chains are independent (the CPU overlaps them), and besides the keyed prefix only rotl(v1,17) of the first half-round is shared
+static inline void SipRound_pair(sipstate &s,sipstate &t)
+{
+	s.v0 = s.v0+s.v1;
+	t.v0 = t.v0+t.v1;
+	s.v2 = s.v2+s.v3;
+	t.v2 = t.v2+t.v3;
+	s.v1 = sip_rotl(s.v1,13)^s.v0;
+	t.v1 = sip_rotl(t.v1,13)^t.v0;
+	s.v3 = sip_rotl(s.v3,16)^s.v2;
+	t.v3 = sip_rotl(t.v3,16)^t.v2;
+	s.v0 = sip_rotl(s.v0,32);
+	t.v0 = sip_rotl(t.v0,32);
+	//halfround
+	s.v2 = s.v1+s.v2;
+	t.v2 = t.v1+t.v2;
+	s.v0 = s.v0+s.v3;
+	t.v0 = t.v0+t.v3;
+	s.v1 = sip_rotl(s.v1,17)^s.v2;
+	t.v1 = sip_rotl(t.v1,17)^t.v2;
+	s.v3 = sip_rotl(s.v3,21)^s.v0;
+	t.v3 = sip_rotl(t.v3,21)^t.v0;
+	s.v2 = sip_rotl(s.v2,32);
+	t.v2 = sip_rotl(t.v2,32);
+}
+template<int C,int D>
+static inline unsigned long long siphash_cd_pair(const sipctx &ctx,unsigned long long m,unsigned long long delta)
+{
+	unsigned long long m_pie = m^delta;
+	sipstate s = ctx.s;
+	sipstate t = ctx.s;
+	//c-round compression, starting from the v2/v3 half of the first SipRound
+	s.v3 = s.v3^m;
+	t.v3 = t.v3^m_pie;
+	s.v2 = s.v2+s.v3;
+	t.v2 = t.v2+t.v3;
+	s.v3 = sip_rotl(s.v3,16)^s.v2;
+	t.v3 = sip_rotl(t.v3,16)^t.v2;
+	//halfround (v0 and v1 are still the same for both members)
+	unsigned long long v1 = sip_rotl(ctx.s.v1,17);
+	s.v2 = ctx.s.v1+s.v2;
+	t.v2 = ctx.s.v1+t.v2;
+	s.v0 = ctx.s.v0+s.v3;
+	t.v0 = ctx.s.v0+t.v3;
+	s.v1 = v1^s.v2;
+	t.v1 = v1^t.v2;
+	s.v3 = sip_rotl(s.v3,21)^s.v0;
+	t.v3 = sip_rotl(t.v3,21)^t.v0;
+	s.v2 = sip_rotl(s.v2,32);
+	t.v2 = sip_rotl(t.v2,32);
+	for (int i=1;i<C;i++) SipRound_pair(s,t);
+	s.v0 = s.v0^m;
+	t.v0 = t.v0^m_pie;
+	//d-round finalization
+	s.v2 = s.v2^sip_ff;
+	t.v2 = t.v2^sip_ff;
+	for (int i=1;i<D;i++) SipRound_pair(s,t);
+	if (D==0) return (s.v0^s.v1^s.v2^s.v3)^(t.v0^t.v1^t.v2^t.v3);
+	return SipRound_output(s)^SipRound_output(t);
+}
+
+static inline unsigned long long siphash_2_1(sipkey key,unsigned long long m)
+{
+	return siphash_cd<2,1>(key,m);
+}
+static inline unsigned long long siphash_2_2(sipkey key,unsigned long long m)
+{
+	return siphash_cd<2,2>(key,m);
+}
+
+static inline unsigned long long siphash_2_1(const sipctx &ctx,unsigned long long m)
+{
+	return siphash_cd_ctx<2,1>(ctx,m);
+}
+static inline unsigned long long siphash_2_2(const sipctx &ctx,unsigned long long m)
+{
+	return siphash_cd_ctx<2,2>(ctx,m);
+}
+static inline unsigned long long siphash_2_1_bytes(const sipctx &ctx,const unsigned char* data,long long len)
+{
+	return siphash_cd_bytes<2,1>(ctx,data,len);
+}
+static inline unsigned long long siphash_2_2_bytes(const sipctx &ctx,const unsigned char* data,long long len)
+{
+	return siphash_cd_bytes<2,2>(ctx,data,len);
+}
+static inline unsigned long long siphash_2_1_pair(const sipctx &ctx,unsigned long long m,unsigned long long delta)
+{
+	return siphash_cd_pair<2,1>(ctx,m,delta);
+}
+static inline unsigned long long siphash_2_2_pair(const sipctx &ctx,unsigned long long m,unsigned long long delta)
+{
+	return siphash_cd_pair<2,2>(ctx,m,delta);
+}
+
+#endif
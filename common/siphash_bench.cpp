@@ -0,0 +1,163 @@
+/*
+	Benchmark Program - SipHash-2-1 Backends for Differential Counting
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This program measures the inner loop of the data generation programs (hash a pair differing on bit k, \
+	  count the output differences of all 64 output bits) with different backends:
+		word   : siphash_2_1() one message at a time (siphash.h)
+		simd   : siphash_2_1_pair_batch() with the runtime-chosen instruction set (siphash_simd.h), counted with bitcounter.h
+		bslice : siphash_2_1_bitslice_count() (siphash_bitslice.h)
+	All backends must produce the same 64 counters, otherwise the program reports a mismatch.
+	It then hashes messages of the lengths in lengthlist(internal parameter) with the full message processing of siphash.h \
+	  (blocks, padding and length byte), with SipHash-2-1 and with SipHash-2-4 as deployed, and for each length (and for a mix of all of them):
+		bytes  : siphash_cd_bytes() one message at a time (siphash.h)
+		stream : sipstream with the runtime-chosen instruction set (siphash_simd.h)
+	Both must give the same outputs, otherwise the program reports a mismatch.
+
+	Program can be executed with 1 optional operational parameter, the number of pairs as a power of 2 (default 20).
+	i.e.:
+		./siphash_bench
+		./siphash_bench 24
+		SIPHASH_SIMD=avx2 ./siphash_bench
+
+	Output Format
+		One line per backend with the running time and the cost per pair.
+	i.e.:
+		pairs:2^18 k:7 simd:avx512
+		word   0.108s 412.5ns/pair
+		simd   0.001s 4.4ns/pair
+		bslice 0.006s 21.0ns/pair
+		messages:2^18
+		len 7 siphash-2-1 bytes 18.2ns/message stream 19.4ns/message siphash-2-4 bytes 21.3ns/message stream 15.9ns/message
+		...
+		len 128 siphash-2-1 bytes 93.1ns/message stream 33.2ns/message siphash-2-4 bytes 95.1ns/message stream 34.5ns/message
+		len mix siphash-2-1 bytes 46.2ns/message stream 32.2ns/message siphash-2-4 bytes 53.5ns/message stream 34.7ns/message
+*/
+
+#include<iostream>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<ctime>
+#include"siphash_bitslice.h"
+#include"bitcounter.h"
+#include"siprng.h"
+
+using namespace std;
+
+const int batchnum = 256;
+const int lengthlist[] = {7,8,15,16,24,32,64,128};//message lengths in bytes
+const int lengthnum = sizeof(lengthlist)/sizeof(lengthlist[0]);
+const int poolnum = 1024;//distinct messages of maxlen bytes, reused so that they stay in cache
+
+double seconds(clock_t start)
+{
+	return (double)(clock()-start)/CLOCKS_PER_SEC;
+}
+
+int main(int argc, char* argv[])
+{
+	int logn = 20;
+	if (argc>1) logn = atoi(argv[1]);
+	long long inputnum = 1LL<<logn;
+	int k = 7;
+	sipkey key = sip_rng_key(1,0);
+	sipctx ctx = sip_prepare(key);
+	unsigned long long* message = new unsigned long long[inputnum];
+	sip_ran64_batch(sip_rng_stream(1,0,SIP_RNG_MESSAGE),0,message,inputnum);
+	unsigned long long delta = 1ULL<<k;
+	printf("pairs:2^%d k:%d simd:%s\n",logn,k,sip_simd_name());
+	//word
+	long long counter_word[64];
+	for (int j=0;j<64;j++) counter_word[j] = 0;
+	clock_t start = clock();
+	for (long long i=0;i<inputnum;i++)
+	{
+		unsigned long long diffrence = siphash_2_1(key,message[i])^siphash_2_1(key,message[i]^delta);
+		for (int j=0;j<64;j++)
+			if ((diffrence>>j)&1) counter_word[j]++;
+	}
+	double t = seconds(start);
+	printf("word   %.3fs %.1fns/pair\n",t,t*1e9/inputnum);
+	//simd
+	long long counter_simd[64];
+	for (int j=0;j<64;j++) counter_simd[j] = 0;
+	unsigned long long diffrence[batchnum];
+	bitcounter bc;
+	bitcounter_init(bc);
+	start = clock();
+	for (long long i=0;i<inputnum;i+=batchnum)
+	{
+		int num = batchnum;
+		if (inputnum-i<num) num = inputnum-i;
+		siphash_2_1_pair_batch(ctx,message+i,delta,diffrence,num);
+		bitcounter_add(bc,diffrence,num);
+	}
+	bitcounter_flush(bc,counter_simd);
+	t = seconds(start);
+	printf("simd   %.3fs %.1fns/pair\n",t,t*1e9/inputnum);
+	//bitslice
+	long long counter_bs[64];
+	for (int j=0;j<64;j++) counter_bs[j] = 0;
+	start = clock();
+	siphash_2_1_bitslice_count(ctx,message,inputnum,delta,counter_bs);
+	t = seconds(start);
+	printf("bslice %.3fs %.1fns/pair\n",t,t*1e9/inputnum);
+	//check
+	int mismatch = 0;
+	for (int j=0;j<64;j++)
+		if ((counter_word[j]!=counter_simd[j])||(counter_word[j]!=counter_bs[j]))
+		{
+			printf("mismatch on output bit %d: word:%lld simd:%lld bslice:%lld\n",j,counter_word[j],counter_simd[j],counter_bs[j]);
+			mismatch = 1;
+		}
+	//messages of several blocks
+	printf("messages:2^%d\n",logn);
+	int maxlen = 0;
+	for (int l=0;l<lengthnum;l++)
+		if (lengthlist[l]>maxlen) maxlen = lengthlist[l];
+	unsigned char* data = new unsigned char[poolnum*maxlen];
+	for (long long i=0;i<poolnum*maxlen;i++) data[i] = (unsigned char)(message[(i/8)%inputnum]>>(8*(i%8)));
+	long long* len = new long long[inputnum];
+	unsigned long long* output_bytes = new unsigned long long[inputnum];
+	unsigned long long* output_stream = new unsigned long long[inputnum];
+	for (int l=0;l<=lengthnum;l++)
+	{
+		//l = lengthnum: lengths drawn from lengthlist
+		for (long long i=0;i<inputnum;i++) len[i] = (l<lengthnum)?lengthlist[l]:lengthlist[message[i]%lengthnum];
+		if (l<lengthnum) printf("len %d",lengthlist[l]);
+		else printf("len mix");
+		for (int cd=0;cd<2;cd++)
+		{
+			start = clock();
+			for (long long i=0;i<inputnum;i++)
+			{
+				if (cd==0) output_bytes[i] = siphash_cd_bytes<2,1>(ctx,data+(i%poolnum)*maxlen,len[i]);
+				else output_bytes[i] = siphash_cd_bytes<2,4>(ctx,data+(i%poolnum)*maxlen,len[i]);
+			}
+			double tb = seconds(start);
+			sipstream st;
+			if (cd==0) sipstream_init<2,1>(st,ctx);
+			else sipstream_init<2,4>(st,ctx);
+			start = clock();
+			for (long long i=0;i<inputnum;i++) sipstream_add(st,data+(i%poolnum)*maxlen,len[i],output_stream+i);
+			sipstream_flush(st);
+			double ts = seconds(start);
+			printf(" %s bytes %.1fns/message stream %.1fns/message",(cd==0)?"siphash-2-1":"siphash-2-4",tb*1e9/inputnum,ts*1e9/inputnum);
+			for (long long i=0;i<inputnum;i++)
+				if (output_bytes[i]!=output_stream[i])
+				{
+					printf("\nmismatch on message %lld",i);
+					mismatch = 1;
+					break;
+				}
+		}
+		printf("\n");
+	}
+	delete[] data;
+	delete[] len;
+	delete[] output_bytes;
+	delete[] output_stream;
+	delete[] message;
+	return mismatch;
+}
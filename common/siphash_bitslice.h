@@ -0,0 +1,274 @@
+/*
+	Reduced-Round SipHash - Bitsliced Engine
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This header evaluates SipHash-c-d on 64 messages at once (or 256/512 with AVX2/AVX-512), \
+	  as an alternative backend to siphash_cd<C,D>() for differential counting.
+	Every 64-bit state word is stored as 64 bit-slices, slice i holding bit i of the word for all messages:
+		additions are bitsliced ripple-carry adds,
+		rotations are free (only the slice index offset of the word changes),
+		the output comes out as 64 bit-columns, so output differences are counted with one popcount per output bit.
+	The lane width is chosen at runtime in the same way as in siphash_simd.h.
+	The ripple-carry additions cost about 64 times more than word additions, which 64~512 lanes do not make up for: \
+	  the engine is several times slower than siphash_cd_pair_batch() (see siphash_bench.cpp), \
+	  and is kept as an independent implementation to check the counters of the word-wise kernels.
+
+	Usage:
+		long long counter[64] = {0};
+		sipctx ctx = sip_prepare(key);
+		siphash_cd_bitslice_count<2,1>(ctx,message,inputnum,1ULL<<k,counter);
+	which gives the same counter[j] as
+		for each i: counter[j] += bit j of siphash_cd<2,1>(key,message[i])^siphash_cd<2,1>(key,message[i]^(1ULL<<k))
+*/
+
+#ifndef SIPHASH_BITSLICE_H
+#define SIPHASH_BITSLICE_H
+
+#include"siphash_simd.h"
+
+#define SIP_BS_INLINE inline __attribute__((always_inline))
+
+typedef unsigned long long bsw64;
+typedef unsigned long long bsw256 __attribute__((vector_size(32)));
+typedef unsigned long long bsw512 __attribute__((vector_size(64)));
+
+//logical bit i of the word is s[(i-r)&63], so rotating left by n is r += n
+template<typename W>
+struct bsword
+{
+	W s[64];
+	int r;
+};
+
+template<typename W>
+struct bsstate
+{
+	bsword<W> v0,v1,v2,v3;
+};
+
+//all-ones slice if bit = 1, all-zeros slice otherwise
+template<typename W>
+static SIP_BS_INLINE void bs_fill(W &a,int bit)
+{
+	W zero = {};
+	if (bit) a = ~zero;
+	else a = zero;
+}
+
+template<typename W>
+static SIP_BS_INLINE void bs_const(bsword<W> &a,unsigned long long c)
+{
+	for (int i=0;i<64;i++) bs_fill(a.s[i],(c>>i)&1);
+	a.r = 0;
+}
+
+template<typename W>
+static SIP_BS_INLINE void bs_rotl(bsword<W> &a,int length)
+{
+	a.r = (a.r+length)&63;
+}
+
+//a ^= b
+template<typename W>
+static SIP_BS_INLINE void bs_xor(bsword<W> &a,const bsword<W> &b)
+{
+	int shift = (a.r-b.r)&63;
+	for (int p=0;p<64;p++) a.s[p] ^= b.s[(p+shift)&63];
+}
+
+//a += b (ripple-carry from logical bit 0 upwards)
+template<typename W>
+static SIP_BS_INLINE void bs_add(bsword<W> &a,const bsword<W> &b)
+{
+	W carry = {};
+	for (int i=0;i<64;i++)
+	{
+		int pa = (i-a.r)&63;
+		W x = a.s[pa];
+		W y = b.s[(i-b.r)&63];
+		W t = x^y;
+		a.s[pa] = t^carry;
+		carry = (x&y)|(carry&t);
+	}
+}
+
+template<typename W>
+static SIP_BS_INLINE void SipHalfRound_bs(bsstate<W> &s)
+{
+	bs_add(s.v2,s.v1);
+	bs_add(s.v0,s.v3);
+	bs_rotl(s.v1,17);
+	bs_rotl(s.v3,21);
+	bs_xor(s.v1,s.v2);
+	bs_xor(s.v3,s.v0);
+	bs_rotl(s.v2,32);
+}
+template<typename W>
+static SIP_BS_INLINE void SipRound_bs(bsstate<W> &s)
+{
+	bs_add(s.v0,s.v1);
+	bs_add(s.v2,s.v3);
+	bs_rotl(s.v1,13);
+	bs_rotl(s.v3,16);
+	bs_xor(s.v1,s.v0);
+	bs_xor(s.v3,s.v2);
+	bs_rotl(s.v0,32);
+	//halfround
+	SipHalfRound_bs(s);
+}
+
+template<typename W>
+static SIP_BS_INLINE const W &bs_bit(const bsword<W> &a,int i)  //logical bit i
+{
+	return a.s[(i-a.r)&63];
+}
+
+//last SipRound fused with the output, without the v0 lane (v0 cancels, see SipRound_output in siphash.h):
+//	out[j] = v1[j-17]^v3[j-21]^v2'[j]^v2'[j-32] with v2' = v2+v1 after the first halfround
+template<typename W>
+static SIP_BS_INLINE void SipRound_output_bs(bsstate<W> &s,W* out)
+{
+	bs_add(s.v0,s.v1);
+	bs_add(s.v2,s.v3);
+	bs_rotl(s.v1,13);
+	bs_rotl(s.v3,16);
+	bs_xor(s.v1,s.v0);
+	bs_xor(s.v3,s.v2);
+	//halfround
+	bs_add(s.v2,s.v1);
+	for (int j=0;j<64;j++) out[j] = bs_bit(s.v1,j-17)^bs_bit(s.v3,j-21)^bs_bit(s.v2,j)^bs_bit(s.v2,j-32);
+}
+
+//out[j] = bit-column j of siphash_cd<C,D>(key,m) for all messages in the slices of m
+template<int C,int D,typename W>
+static SIP_BS_INLINE void siphash_cd_bs(const sipctx &ctx,const bsword<W> &m,W* out)
+{
+	bsstate<W> s;
+	bs_const(s.v0,ctx.s.v0);
+	bs_const(s.v1,ctx.s.v1);
+	bs_const(s.v2,ctx.s.v2);
+	bs_const(s.v3,ctx.s.v3);
+	//c-round compression, starting from the v2/v3 half of the first SipRound
+	bs_xor(s.v3,m);
+	bs_add(s.v2,s.v3);
+	bs_rotl(s.v3,16);
+	bs_xor(s.v3,s.v2);
+	SipHalfRound_bs(s);
+	for (int i=1;i<C;i++) SipRound_bs(s);
+	bs_xor(s.v0,m);
+	//d-round finalization
+	bsword<W> ff;
+	bs_const(ff,sip_ff);
+	bs_xor(s.v2,ff);
+	if (D==0)
+	{
+		for (int j=0;j<64;j++) out[j] = bs_bit(s.v0,j)^bs_bit(s.v1,j)^bs_bit(s.v2,j)^bs_bit(s.v3,j);
+		return;
+	}
+	for (int i=1;i<D;i++) SipRound_bs(s);
+	SipRound_output_bs(s,out);
+}
+
+//64x64 bit transpose in place: afterwards bit b of a[i] is bit i of the former a[b]
+static inline void bs_transpose64(unsigned long long* a)
+{
+	unsigned long long mask = 0x00000000ffffffff;
+	for (int j=32;j!=0;j>>=1,mask^=(mask<<j))
+		for (int k=0;k<64;k=((k|j)+1)&~j)
+		{
+			unsigned long long t = ((a[k]>>j)^a[k|j])&mask;
+			a[k] = a[k]^(t<<j);
+			a[k|j] = a[k|j]^t;
+		}
+}
+
+template<typename W>
+static SIP_BS_INLINE long long bs_popcount(const W &a)
+{
+	const unsigned long long* p = (const unsigned long long*)&a;
+	long long ans = 0;
+	for (unsigned int l=0;l<sizeof(W)/8;l++) ans += __builtin_popcountll(p[l]);
+	return ans;
+}
+
+//counter[j] += number of i<n with bit j of siphash_cd<C,D>(key,m[i])^siphash_cd<C,D>(key,m[i]^delta) set
+template<int C,int D,typename W>
+static SIP_BS_INLINE void siphash_cd_bs_count(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,long long* counter)
+{
+	const int lanes = sizeof(W)/8;
+	const long long block = 64*lanes;
+	unsigned long long slice[64];
+	bsword<W> in,in_pie;
+	W out[64],out_pie[64];
+	for (long long base=0;base<n;base+=block)
+	{
+		W valid = {};
+		for (int l=0;l<lanes;l++)
+		{
+			long long first = base+64*l;
+			long long num = n-first;
+			if (num>64) num = 64;
+			if (num<0) num = 0;
+			for (int b=0;b<64;b++) slice[b] = (b<num)?m[first+b]:0;
+			bs_transpose64(slice);
+			unsigned long long* pin = (unsigned long long*)in.s;
+			for (int i=0;i<64;i++) pin[i*lanes+l] = slice[i];
+			((unsigned long long*)&valid)[l] = (num==64)?0xffffffffffffffffULL:((1ULL<<num)-1);
+		}
+		in.r = 0;
+		in_pie = in;
+		for (int i=0;i<64;i++)
+			if ((delta>>i)&1) in_pie.s[i] = ~in_pie.s[i];
+		siphash_cd_bs<C,D,W>(ctx,in,out);
+		siphash_cd_bs<C,D,W>(ctx,in_pie,out_pie);
+		for (int j=0;j<64;j++)
+		{
+			W diffrence = (out[j]^out_pie[j])&valid;
+			counter[j] += bs_popcount(diffrence);
+		}
+	}
+}
+
+template<int C,int D>
+static void siphash_cd_bs_count_64(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,long long* counter)
+{
+	siphash_cd_bs_count<C,D,bsw64>(ctx,m,n,delta,counter);
+}
+#ifdef SIPHASH_SIMD_X86
+template<int C,int D>
+__attribute__((target("avx2"))) static void siphash_cd_bs_count_256(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,long long* counter)
+{
+	siphash_cd_bs_count<C,D,bsw256>(ctx,m,n,delta,counter);
+}
+template<int C,int D>
+__attribute__((target("avx512f"))) static void siphash_cd_bs_count_512(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,long long* counter)
+{
+	siphash_cd_bs_count<C,D,bsw512>(ctx,m,n,delta,counter);
+}
+#endif
+
+template<int C,int D>
+static inline void siphash_cd_bitslice_count(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,long long* counter)
+{
+#ifdef SIPHASH_SIMD_X86
+	int level = sip_simd_level();
+	if (level==SIP_AVX512)
+	{
+		siphash_cd_bs_count_512<C,D>(ctx,m,n,delta,counter);
+		return;
+	}
+	if (level==SIP_AVX2)
+	{
+		siphash_cd_bs_count_256<C,D>(ctx,m,n,delta,counter);
+		return;
+	}
+#endif
+	siphash_cd_bs_count_64<C,D>(ctx,m,n,delta,counter);
+}
+
+static inline void siphash_2_1_bitslice_count(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,long long* counter)
+{
+	siphash_cd_bitslice_count<2,1>(ctx,m,n,delta,counter);
+}
+
+#endif
@@ -0,0 +1,649 @@
+/*
+	Reduced-Round SipHash - Multi-Message SIMD Kernel
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This header hashes a batch of 64-bit messages under one key, 4 messages per step with AVX2 \
+	  or 8 messages per step with AVX-512 (native vprolq rotates), \
+	  or one message under a batch of keys (exhaustive key search), with one key per lane.
+	Messages of several blocks (see siphash.h) are hashed in the same way, one message per lane, the lanes gathering their blocks one at a time; \
+	  messages of different lengths are queued by number of blocks in a sipstream, and each queue is hashed once it is full.
+	The instruction set is chosen at runtime, so one binary runs on every x86 machine:
+		AVX-512F > AVX2 > scalar (siphash.h)
+	The choice can be forced with the environment variable SIPHASH_SIMD=scalar/avx2/avx512 (e.g. for benchmarking).
+	Outputs are exactly the same as siphash_cd<C,D>() in siphash.h.
+	The pair kernels run the plain kernel on m and m^delta in the same step: \
+	  they save the buffers and memory traffic of two batch calls (partner messages and outputs), not hashing work.
+	The kernels start from the per-key prefix of siphash.h (sipctx), so a caller hashing many batches \
+	  under one key should call sip_prepare() once and pass the context.
+
+	Usage:
+		unsigned long long message[256],output[256];
+		sipctx ctx = sip_prepare(key);
+		siphash_cd_batch<2,1>(ctx,message,output,256);
+		siphash_cd_pair_batch<2,1>(ctx,message,1ULL<<k,diffrence,256);  //diffrence[i] = output(message[i])^output(message[i]^(1<<k))
+		siphash_cd_pair_count<2,2>(ctx,message,256,1ULL<<k,1ULL<<57,counter);  //counter[57] += pairs with a difference on output bit 57
+		siphash_cd_keys_batch<2,1>(k0,k1,m,output,256);  //output[i] = output of m under key (k0[i],k1[i])
+		siphash_cd_blocks_batch<2,1>(ctx,block,3,output,256);  //message i = blocks block[3*i..3*i+2], padding included
+		sipstream st;
+		sipstream_init<2,4>(st,ctx);
+		sipstream_add(st,data,len,&output[i]);  //any number of messages of any length
+		sipstream_flush(st);  //all outputs written
+	The last SipRound skips the v0 lane, which cancels in the output (see SipRound_output in siphash.h).
+*/
+
+#ifndef SIPHASH_SIMD_H
+#define SIPHASH_SIMD_H
+
+#include<cstdlib>
+#include<cstring>
+#include<vector>
+#include"siphash.h"
+
+#if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+#define SIPHASH_SIMD_X86
+#include<immintrin.h>
+#endif
+
+enum {SIP_SCALAR = 0,SIP_AVX2 = 1,SIP_AVX512 = 2};
+
+static inline int sip_detect_simd()
+{
+	int level = SIP_SCALAR;
+#ifdef SIPHASH_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) level = SIP_AVX2;
+	if (__builtin_cpu_supports("avx512f")) level = SIP_AVX512;
+#endif
+	const char* force = getenv("SIPHASH_SIMD");
+	if (force!=NULL)
+	{
+		if (strcmp(force,"scalar")==0) level = SIP_SCALAR;
+		if ((strcmp(force,"avx2")==0)&&(level>SIP_AVX2)) level = SIP_AVX2;
+	}
+	return level;
+}
+static inline int sip_simd_level()
+{
+	static const int level = sip_detect_simd();
+	return level;
+}
+static inline const char* sip_simd_name()
+{
+	const char* name[3] = {"scalar","avx2","avx512"};
+	return name[sip_simd_level()];
+}
+
+#ifdef SIPHASH_SIMD_X86
+
+//4 messages per step
+template<int R>
+__attribute__((target("avx2"))) static inline __m256i sip_rotl_avx2(__m256i a)
+{
+	return _mm256_or_si256(_mm256_slli_epi64(a,R),_mm256_srli_epi64(a,64-R));
+}
+__attribute__((target("avx2"))) static inline void SipHalfRound_avx2(__m256i &v0,__m256i &v1,__m256i &v2,__m256i &v3)
+{
+	v2 = _mm256_add_epi64(v1,v2);
+	v0 = _mm256_add_epi64(v0,v3);
+	v1 = sip_rotl_avx2<17>(v1);
+	v3 = sip_rotl_avx2<21>(v3);
+	v1 = _mm256_xor_si256(v1,v2);
+	v3 = _mm256_xor_si256(v0,v3);
+	v2 = _mm256_shuffle_epi32(v2,_MM_SHUFFLE(2,3,0,1));//rotate 32
+}
+__attribute__((target("avx2"))) static inline void SipRound_avx2(__m256i &v0,__m256i &v1,__m256i &v2,__m256i &v3)
+{
+	v0 = _mm256_add_epi64(v0,v1);
+	v2 = _mm256_add_epi64(v2,v3);
+	v1 = sip_rotl_avx2<13>(v1);
+	v3 = sip_rotl_avx2<16>(v3);
+	v1 = _mm256_xor_si256(v0,v1);
+	v3 = _mm256_xor_si256(v2,v3);
+	v0 = _mm256_shuffle_epi32(v0,_MM_SHUFFLE(2,3,0,1));//rotate 32
+	//halfround
+	SipHalfRound_avx2(v0,v1,v2,v3);
+}
+//last SipRound fused with the output, without the v0 lane (see SipRound_output in siphash.h)
+__attribute__((target("avx2"))) static inline __m256i SipRound_output_avx2(__m256i v0,__m256i v1,__m256i v2,__m256i v3)
+{
+	v0 = _mm256_add_epi64(v0,v1);
+	v2 = _mm256_add_epi64(v2,v3);
+	v1 = sip_rotl_avx2<13>(v1);
+	v3 = sip_rotl_avx2<16>(v3);
+	v1 = _mm256_xor_si256(v0,v1);
+	v3 = _mm256_xor_si256(v2,v3);
+	//halfround
+	v2 = _mm256_add_epi64(v1,v2);
+	__m256i t = _mm256_xor_si256(sip_rotl_avx2<17>(v1),sip_rotl_avx2<21>(v3));
+	return _mm256_xor_si256(t,_mm256_xor_si256(v2,_mm256_shuffle_epi32(v2,_MM_SHUFFLE(2,3,0,1))));
+}
+//k[0..3]: broadcast sipctx state, k[4]: broadcast 0xff
+//c-round compression of the block mm, starting from the keyed context
+template<int C>
+__attribute__((target("avx2"))) static inline void SipCompress_ctx_avx2(const __m256i* k,__m256i mm,__m256i &v0,__m256i &v1,__m256i &v2,__m256i &v3)
+{
+	v0 = k[0];
+	v1 = k[1];
+	v3 = _mm256_xor_si256(k[3],mm);
+	//rest of the first SipRound
+	v2 = _mm256_add_epi64(k[2],v3);
+	v3 = sip_rotl_avx2<16>(v3);
+	v3 = _mm256_xor_si256(v2,v3);
+	SipHalfRound_avx2(v0,v1,v2,v3);
+	for (int r=1;r<C;r++) SipRound_avx2(v0,v1,v2,v3);
+	v0 = _mm256_xor_si256(v0,mm);
+}
+//c-round compression of a following block mm
+template<int C>
+__attribute__((target("avx2"))) static inline void SipCompress_avx2(__m256i mm,__m256i &v0,__m256i &v1,__m256i &v2,__m256i &v3)
+{
+	v3 = _mm256_xor_si256(v3,mm);
+	for (int r=0;r<C;r++) SipRound_avx2(v0,v1,v2,v3);
+	v0 = _mm256_xor_si256(v0,mm);
+}
+//d-round finalization
+template<int D>
+__attribute__((target("avx2"))) static inline __m256i SipFinalize_avx2(const __m256i* k,__m256i v0,__m256i v1,__m256i v2,__m256i v3)
+{
+	v2 = _mm256_xor_si256(v2,k[4]);
+	if (D==0) return _mm256_xor_si256(_mm256_xor_si256(v0,v1),_mm256_xor_si256(v2,v3));
+	for (int r=1;r<D;r++) SipRound_avx2(v0,v1,v2,v3);
+	return SipRound_output_avx2(v0,v1,v2,v3);
+}
+template<int C,int D>
+__attribute__((target("avx2"))) static inline __m256i siphash_cd_avx2(const __m256i* k,__m256i mm)
+{
+	__m256i v0,v1,v2,v3;
+	SipCompress_ctx_avx2<C>(k,mm,v0,v1,v2,v3);
+	return SipFinalize_avx2<D>(k,v0,v1,v2,v3);
+}
+__attribute__((target("avx2"))) static inline void sip_broadcast_avx2(const sipctx &ctx,__m256i* k)
+{
+	k[0] = _mm256_set1_epi64x(ctx.s.v0);
+	k[1] = _mm256_set1_epi64x(ctx.s.v1);
+	k[2] = _mm256_set1_epi64x(ctx.s.v2);
+	k[3] = _mm256_set1_epi64x(ctx.s.v3);
+	k[4] = _mm256_set1_epi64x(sip_ff);
+}
+template<int C,int D>
+__attribute__((target("avx2"))) static long long siphash_cd_batch_avx2(const sipctx &ctx,const unsigned long long* m,unsigned long long* out,long long n)
+{
+	__m256i k[5];
+	sip_broadcast_avx2(ctx,k);
+	long long i = 0;
+	for (;i+4<=n;i+=4)
+	{
+		__m256i mm = _mm256_loadu_si256((const __m256i*)(m+i));
+		_mm256_storeu_si256((__m256i*)(out+i),siphash_cd_avx2<C,D>(k,mm));
+	}
+	return i;
+}
+//the two members of each pair hashed in the same step (no round work shared), the message loaded once and only the output difference stored
+template<int C,int D>
+__attribute__((target("avx2"))) static long long siphash_cd_pair_batch_avx2(const sipctx &ctx,const unsigned long long* m,unsigned long long delta,unsigned long long* out,long long n)
+{
+	__m256i k[5];
+	sip_broadcast_avx2(ctx,k);
+	const __m256i dd = _mm256_set1_epi64x(delta);
+	long long i = 0;
+	for (;i+4<=n;i+=4)
+	{
+		__m256i mm = _mm256_loadu_si256((const __m256i*)(m+i));
+		__m256i output = siphash_cd_avx2<C,D>(k,mm);
+		__m256i output_pie = siphash_cd_avx2<C,D>(k,_mm256_xor_si256(mm,dd));
+		_mm256_storeu_si256((__m256i*)(out+i),_mm256_xor_si256(output,output_pie));
+	}
+	return i;
+}
+//4 messages of nblock blocks per step, message i at block[i*nblock..], gathered block by block
+template<int C,int D>
+__attribute__((target("avx2"))) static long long siphash_cd_blocks_batch_avx2(const sipctx &ctx,const unsigned long long* block,long long nblock,unsigned long long* out,long long n)
+{
+	__m256i k[5];
+	sip_broadcast_avx2(ctx,k);
+	const __m256i index = _mm256_set_epi64x(3*nblock,2*nblock,nblock,0);
+	long long i = 0;
+	for (;i+4<=n;i+=4)
+	{
+		const long long* mb = (const long long*)(block+i*nblock);
+		__m256i v0,v1,v2,v3;
+		SipCompress_ctx_avx2<C>(k,_mm256_i64gather_epi64(mb,index,8),v0,v1,v2,v3);
+		for (long long b=1;b<nblock;b++) SipCompress_avx2<C>(_mm256_i64gather_epi64(mb+b,index,8),v0,v1,v2,v3);
+		_mm256_storeu_si256((__m256i*)(out+i),SipFinalize_avx2<D>(k,v0,v1,v2,v3));
+	}
+	return i;
+}
+//only the requested output bits bit[0..nbit-1] of each difference are counted, in registers
+template<int C,int D>
+__attribute__((target("avx2"))) static long long siphash_cd_pair_count_avx2(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,const int* bit,int nbit,long long* counter)
+{
+	__m256i k[5];
+	sip_broadcast_avx2(ctx,k);
+	const __m256i dd = _mm256_set1_epi64x(delta);
+	const __m256i one = _mm256_set1_epi64x(1);
+	__m256i acc[64];
+	for (int t=0;t<nbit;t++) acc[t] = _mm256_setzero_si256();
+	long long i = 0;
+	for (;i+4<=n;i+=4)
+	{
+		__m256i mm = _mm256_loadu_si256((const __m256i*)(m+i));
+		__m256i diffrence = _mm256_xor_si256(siphash_cd_avx2<C,D>(k,mm),siphash_cd_avx2<C,D>(k,_mm256_xor_si256(mm,dd)));
+		for (int t=0;t<nbit;t++) acc[t] = _mm256_add_epi64(acc[t],_mm256_and_si256(_mm256_srl_epi64(diffrence,_mm_cvtsi32_si128(bit[t])),one));
+	}
+	for (int t=0;t<nbit;t++)
+	{
+		unsigned long long lane[4];
+		_mm256_storeu_si256((__m256i*)lane,acc[t]);
+		for (int l=0;l<4;l++) counter[bit[t]] += lane[l];
+	}
+	return i;
+}
+
+//the k[] of siphash_cd_avx2 (sipctx state, see sip_prepare) for 4 different keys
+__attribute__((target("avx2"))) static inline void sip_prepare_avx2(__m256i kk0,__m256i kk1,__m256i* k)
+{
+	__m256i v0 = _mm256_xor_si256(_mm256_set1_epi64x(sip_h[0]),kk0);
+	__m256i v1 = _mm256_xor_si256(_mm256_set1_epi64x(sip_h[1]),kk1);
+	v0 = _mm256_add_epi64(v0,v1);
+	v1 = sip_rotl_avx2<13>(v1);
+	v1 = _mm256_xor_si256(v0,v1);
+	k[0] = _mm256_shuffle_epi32(v0,_MM_SHUFFLE(2,3,0,1));//rotate 32
+	k[1] = v1;
+	k[2] = _mm256_xor_si256(_mm256_set1_epi64x(sip_h[2]),kk0);
+	k[3] = _mm256_xor_si256(_mm256_set1_epi64x(sip_h[3]),kk1);
+	k[4] = _mm256_set1_epi64x(sip_ff);
+}
+//one message under 4 keys per step
+template<int C,int D>
+__attribute__((target("avx2"))) static long long siphash_cd_keys_batch_avx2(const unsigned long long* k0,const unsigned long long* k1,unsigned long long m,unsigned long long* out,long long n)
+{
+	const __m256i mm = _mm256_set1_epi64x(m);
+	__m256i k[5];
+	long long i = 0;
+	for (;i+4<=n;i+=4)
+	{
+		sip_prepare_avx2(_mm256_loadu_si256((const __m256i*)(k0+i)),_mm256_loadu_si256((const __m256i*)(k1+i)),k);
+		_mm256_storeu_si256((__m256i*)(out+i),siphash_cd_avx2<C,D>(k,mm));
+	}
+	return i;
+}
+
+//8 messages per step
+template<int R>
+__attribute__((target("avx512f"))) static inline __m512i sip_rotl_avx512(__m512i a)
+{
+	return _mm512_mask_rol_epi64(a,0xff,a,R);//vprolq, merge form avoids gcc's undefined-source warning
+}
+__attribute__((target("avx512f"))) static inline void SipHalfRound_avx512(__m512i &v0,__m512i &v1,__m512i &v2,__m512i &v3)
+{
+	v2 = _mm512_add_epi64(v1,v2);
+	v0 = _mm512_add_epi64(v0,v3);
+	v1 = sip_rotl_avx512<17>(v1);
+	v3 = sip_rotl_avx512<21>(v3);
+	v1 = _mm512_xor_si512(v1,v2);
+	v3 = _mm512_xor_si512(v0,v3);
+	v2 = sip_rotl_avx512<32>(v2);
+}
+__attribute__((target("avx512f"))) static inline void SipRound_avx512(__m512i &v0,__m512i &v1,__m512i &v2,__m512i &v3)
+{
+	v0 = _mm512_add_epi64(v0,v1);
+	v2 = _mm512_add_epi64(v2,v3);
+	v1 = sip_rotl_avx512<13>(v1);
+	v3 = sip_rotl_avx512<16>(v3);
+	v1 = _mm512_xor_si512(v0,v1);
+	v3 = _mm512_xor_si512(v2,v3);
+	v0 = sip_rotl_avx512<32>(v0);
+	//halfround
+	SipHalfRound_avx512(v0,v1,v2,v3);
+}
+//last SipRound fused with the output, without the v0 lane (see SipRound_output in siphash.h)
+__attribute__((target("avx512f"))) static inline __m512i SipRound_output_avx512(__m512i v0,__m512i v1,__m512i v2,__m512i v3)
+{
+	v0 = _mm512_add_epi64(v0,v1);
+	v2 = _mm512_add_epi64(v2,v3);
+	v1 = sip_rotl_avx512<13>(v1);
+	v3 = sip_rotl_avx512<16>(v3);
+	v1 = _mm512_xor_si512(v0,v1);
+	v3 = _mm512_xor_si512(v2,v3);
+	//halfround
+	v2 = _mm512_add_epi64(v1,v2);
+	__m512i t = _mm512_xor_si512(sip_rotl_avx512<17>(v1),sip_rotl_avx512<21>(v3));
+	return _mm512_ternarylogic_epi64(t,v2,sip_rotl_avx512<32>(v2),0x96);//t^v2^(v2<<<32)
+}
+//k[0..3]: broadcast sipctx state, k[4]: broadcast 0xff
+//c-round compression of the block mm, starting from the keyed context
+template<int C>
+__attribute__((target("avx512f"))) static inline void SipCompress_ctx_avx512(const __m512i* k,__m512i mm,__m512i &v0,__m512i &v1,__m512i &v2,__m512i &v3)
+{
+	v0 = k[0];
+	v1 = k[1];
+	v3 = _mm512_xor_si512(k[3],mm);
+	//rest of the first SipRound
+	v2 = _mm512_add_epi64(k[2],v3);
+	v3 = sip_rotl_avx512<16>(v3);
+	v3 = _mm512_xor_si512(v2,v3);
+	SipHalfRound_avx512(v0,v1,v2,v3);
+	for (int r=1;r<C;r++) SipRound_avx512(v0,v1,v2,v3);
+	v0 = _mm512_xor_si512(v0,mm);
+}
+//c-round compression of a following block mm
+template<int C>
+__attribute__((target("avx512f"))) static inline void SipCompress_avx512(__m512i mm,__m512i &v0,__m512i &v1,__m512i &v2,__m512i &v3)
+{
+	v3 = _mm512_xor_si512(v3,mm);
+	for (int r=0;r<C;r++) SipRound_avx512(v0,v1,v2,v3);
+	v0 = _mm512_xor_si512(v0,mm);
+}
+//d-round finalization
+template<int D>
+__attribute__((target("avx512f"))) static inline __m512i SipFinalize_avx512(const __m512i* k,__m512i v0,__m512i v1,__m512i v2,__m512i v3)
+{
+	v2 = _mm512_xor_si512(v2,k[4]);
+	if (D==0) return _mm512_xor_si512(_mm512_xor_si512(v0,v1),_mm512_xor_si512(v2,v3));
+	for (int r=1;r<D;r++) SipRound_avx512(v0,v1,v2,v3);
+	return SipRound_output_avx512(v0,v1,v2,v3);
+}
+template<int C,int D>
+__attribute__((target("avx512f"))) static inline __m512i siphash_cd_avx512(const __m512i* k,__m512i mm)
+{
+	__m512i v0,v1,v2,v3;
+	SipCompress_ctx_avx512<C>(k,mm,v0,v1,v2,v3);
+	return SipFinalize_avx512<D>(k,v0,v1,v2,v3);
+}
+__attribute__((target("avx512f"))) static inline void sip_broadcast_avx512(const sipctx &ctx,__m512i* k)
+{
+	k[0] = _mm512_set1_epi64(ctx.s.v0);
+	k[1] = _mm512_set1_epi64(ctx.s.v1);
+	k[2] = _mm512_set1_epi64(ctx.s.v2);
+	k[3] = _mm512_set1_epi64(ctx.s.v3);
+	k[4] = _mm512_set1_epi64(sip_ff);
+}
+template<int C,int D>
+__attribute__((target("avx512f"))) static long long siphash_cd_batch_avx512(const sipctx &ctx,const unsigned long long* m,unsigned long long* out,long long n)
+{
+	__m512i k[5];
+	sip_broadcast_avx512(ctx,k);
+	long long i = 0;
+	for (;i+8<=n;i+=8)
+	{
+		__m512i mm = _mm512_loadu_si512((const void*)(m+i));
+		_mm512_storeu_si512((void*)(out+i),siphash_cd_avx512<C,D>(k,mm));
+	}
+	return i;
+}
+//the two members of each pair hashed in the same step (no round work shared), the message loaded once and only the output difference stored
+template<int C,int D>
+__attribute__((target("avx512f"))) static long long siphash_cd_pair_batch_avx512(const sipctx &ctx,const unsigned long long* m,unsigned long long delta,unsigned long long* out,long long n)
+{
+	__m512i k[5];
+	sip_broadcast_avx512(ctx,k);
+	const __m512i dd = _mm512_set1_epi64(delta);
+	long long i = 0;
+	for (;i+8<=n;i+=8)
+	{
+		__m512i mm = _mm512_loadu_si512((const void*)(m+i));
+		__m512i output = siphash_cd_avx512<C,D>(k,mm);
+		__m512i output_pie = siphash_cd_avx512<C,D>(k,_mm512_xor_si512(mm,dd));
+		_mm512_storeu_si512((void*)(out+i),_mm512_xor_si512(output,output_pie));
+	}
+	return i;
+}
+//8 messages of nblock blocks per step, message i at block[i*nblock..], gathered block by block
+template<int C,int D>
+__attribute__((target("avx512f"))) static long long siphash_cd_blocks_batch_avx512(const sipctx &ctx,const unsigned long long* block,long long nblock,unsigned long long* out,long long n)
+{
+	__m512i k[5];
+	sip_broadcast_avx512(ctx,k);
+	const __m512i index = _mm512_set_epi64(7*nblock,6*nblock,5*nblock,4*nblock,3*nblock,2*nblock,nblock,0);
+	const __m512i zero = _mm512_setzero_si512();//merge form of the gather avoids gcc's undefined-source warning
+	long long i = 0;
+	for (;i+8<=n;i+=8)
+	{
+		const unsigned long long* mb = block+i*nblock;
+		__m512i v0,v1,v2,v3;
+		SipCompress_ctx_avx512<C>(k,_mm512_mask_i64gather_epi64(zero,0xff,index,(const void*)mb,8),v0,v1,v2,v3);
+		for (long long b=1;b<nblock;b++) SipCompress_avx512<C>(_mm512_mask_i64gather_epi64(zero,0xff,index,(const void*)(mb+b),8),v0,v1,v2,v3);
+		_mm512_storeu_si512((void*)(out+i),SipFinalize_avx512<D>(k,v0,v1,v2,v3));
+	}
+	return i;
+}
+//only the requested output bits bit[0..nbit-1] of each difference are counted, in registers
+template<int C,int D>
+__attribute__((target("avx512f"))) static long long siphash_cd_pair_count_avx512(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,const int* bit,int nbit,long long* counter)
+{
+	__m512i k[5];
+	sip_broadcast_avx512(ctx,k);
+	const __m512i dd = _mm512_set1_epi64(delta);
+	const __m512i one = _mm512_set1_epi64(1);
+	__m512i acc[64];
+	for (int t=0;t<nbit;t++) acc[t] = _mm512_setzero_si512();
+	long long i = 0;
+	for (;i+8<=n;i+=8)
+	{
+		__m512i mm = _mm512_loadu_si512((const void*)(m+i));
+		__m512i diffrence = _mm512_xor_si512(siphash_cd_avx512<C,D>(k,mm),siphash_cd_avx512<C,D>(k,_mm512_xor_si512(mm,dd)));
+		for (int t=0;t<nbit;t++) acc[t] = _mm512_add_epi64(acc[t],_mm512_and_si512(_mm512_maskz_srl_epi64(0xff,diffrence,_mm_cvtsi32_si128(bit[t])),one));
+	}
+	for (int t=0;t<nbit;t++)
+	{
+		unsigned long long lane[8];
+		_mm512_storeu_si512((void*)lane,acc[t]);
+		for (int l=0;l<8;l++) counter[bit[t]] += lane[l];
+	}
+	return i;
+}
+//the k[] of siphash_cd_avx512 (sipctx state, see sip_prepare) for 8 different keys
+__attribute__((target("avx512f"))) static inline void sip_prepare_avx512(__m512i kk0,__m512i kk1,__m512i* k)
+{
+	__m512i v0 = _mm512_xor_si512(_mm512_set1_epi64(sip_h[0]),kk0);
+	__m512i v1 = _mm512_xor_si512(_mm512_set1_epi64(sip_h[1]),kk1);
+	v0 = _mm512_add_epi64(v0,v1);
+	v1 = sip_rotl_avx512<13>(v1);
+	v1 = _mm512_xor_si512(v0,v1);
+	k[0] = sip_rotl_avx512<32>(v0);
+	k[1] = v1;
+	k[2] = _mm512_xor_si512(_mm512_set1_epi64(sip_h[2]),kk0);
+	k[3] = _mm512_xor_si512(_mm512_set1_epi64(sip_h[3]),kk1);
+	k[4] = _mm512_set1_epi64(sip_ff);
+}
+//one message under 8 keys per step
+template<int C,int D>
+__attribute__((target("avx512f"))) static long long siphash_cd_keys_batch_avx512(const unsigned long long* k0,const unsigned long long* k1,unsigned long long m,unsigned long long* out,long long n)
+{
+	const __m512i mm = _mm512_set1_epi64(m);
+	__m512i k[5];
+	long long i = 0;
+	for (;i+8<=n;i+=8)
+	{
+		sip_prepare_avx512(_mm512_loadu_si512((const void*)(k0+i)),_mm512_loadu_si512((const void*)(k1+i)),k);
+		_mm512_storeu_si512((void*)(out+i),siphash_cd_avx512<C,D>(k,mm));
+	}
+	return i;
+}
+
+#endif
+
+//out[i] = siphash_cd<C,D>(key,m[i]) for 0<=i<n
+template<int C,int D>
+static inline void siphash_cd_batch(const sipctx &ctx,const unsigned long long* m,unsigned long long* out,long long n)
+{
+	long long i = 0;
+#ifdef SIPHASH_SIMD_X86
+	int level = sip_simd_level();
+	if (level==SIP_AVX512) i = siphash_cd_batch_avx512<C,D>(ctx,m,out,n);
+	else if (level==SIP_AVX2) i = siphash_cd_batch_avx2<C,D>(ctx,m,out,n);
+#endif
+	for (;i<n;i++) out[i] = siphash_cd_ctx<C,D>(ctx,m[i]);
+}
+//out[i] = siphash_cd<C,D>(key,m[i])^siphash_cd<C,D>(key,m[i]^delta) for 0<=i<n
+template<int C,int D>
+static inline void siphash_cd_pair_batch(const sipctx &ctx,const unsigned long long* m,unsigned long long delta,unsigned long long* out,long long n)
+{
+	long long i = 0;
+#ifdef SIPHASH_SIMD_X86
+	int level = sip_simd_level();
+	if (level==SIP_AVX512) i = siphash_cd_pair_batch_avx512<C,D>(ctx,m,delta,out,n);
+	else if (level==SIP_AVX2) i = siphash_cd_pair_batch_avx2<C,D>(ctx,m,delta,out,n);
+#endif
+	for (;i<n;i++) out[i] = siphash_cd_pair<C,D>(ctx,m[i],delta);
+}
+//out[i] = siphash_cd_blocks<C,D>(ctx,block+i*nblock,nblock) for 0<=i<n, i.e. n messages of nblock blocks each, padding included
+template<int C,int D>
+static inline void siphash_cd_blocks_batch(const sipctx &ctx,const unsigned long long* block,long long nblock,unsigned long long* out,long long n)
+{
+	long long i = 0;
+#ifdef SIPHASH_SIMD_X86
+	int level = sip_simd_level();
+	if (level==SIP_AVX512) i = siphash_cd_blocks_batch_avx512<C,D>(ctx,block,nblock,out,n);
+	else if (level==SIP_AVX2) i = siphash_cd_blocks_batch_avx2<C,D>(ctx,block,nblock,out,n);
+#endif
+	for (;i<n;i++) out[i] = siphash_cd_blocks<C,D>(ctx,block+i*nblock,nblock);
+}
+//counter[j] += number of i<n with bit j of siphash_cd_pair<C,D>(ctx,m[i],delta) set, for every bit j in outmask
+//only the requested bits are extracted and counted (e.g. outmask = 1<<57 for the SipHash-2-2 distinguisher)
+template<int C,int D>
+static inline void siphash_cd_pair_count(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,unsigned long long outmask,long long* counter)
+{
+	int bit[64];
+	int nbit = 0;
+	for (int j=0;j<64;j++)
+		if ((outmask>>j)&1) bit[nbit++] = j;
+	long long i = 0;
+#ifdef SIPHASH_SIMD_X86
+	int level = sip_simd_level();
+	if (level==SIP_AVX512) i = siphash_cd_pair_count_avx512<C,D>(ctx,m,n,delta,bit,nbit,counter);
+	else if (level==SIP_AVX2) i = siphash_cd_pair_count_avx2<C,D>(ctx,m,n,delta,bit,nbit,counter);
+#endif
+	for (;i<n;i++)
+	{
+		unsigned long long diffrence = siphash_cd_pair<C,D>(ctx,m[i],delta);
+		for (int t=0;t<nbit;t++) counter[bit[t]] += (diffrence>>bit[t])&1;
+	}
+}
+//out[i] = siphash_cd<C,D>(key,m) with key = (k0[i],k1[i]) for 0<=i<n
+template<int C,int D>
+static inline void siphash_cd_keys_batch(const unsigned long long* k0,const unsigned long long* k1,unsigned long long m,unsigned long long* out,long long n)
+{
+	long long i = 0;
+#ifdef SIPHASH_SIMD_X86
+	int level = sip_simd_level();
+	if (level==SIP_AVX512) i = siphash_cd_keys_batch_avx512<C,D>(k0,k1,m,out,n);
+	else if (level==SIP_AVX2) i = siphash_cd_keys_batch_avx2<C,D>(k0,k1,m,out,n);
+#endif
+	for (;i<n;i++)
+	{
+		sipkey key = {k0[i],k1[i]};
+		out[i] = siphash_cd<C,D>(key,m);
+	}
+}
+template<int C,int D>
+static inline void siphash_cd_batch(sipkey key,const unsigned long long* m,unsigned long long* out,long long n)
+{
+	siphash_cd_batch<C,D>(sip_prepare(key),m,out,n);
+}
+
+//streaming: messages of any length are queued by number of blocks,
+//and each queue is hashed with siphash_cd_blocks_batch once it holds sipstream_batch messages (their blocks are copied, so meant for short messages)
+const int sipstream_batch = 64;
+
+typedef void (*sipblockhash)(const sipctx &ctx,const unsigned long long* block,long long nblock,unsigned long long* out,long long n);
+
+struct sipqueue
+{
+	long long n;  //messages queued
+	std::vector<unsigned long long> block;  //their blocks, one message after the other (room for sipstream_batch messages)
+	unsigned long long* out[sipstream_batch];  //where their outputs go
+};
+
+struct sipstream
+{
+	sipctx ctx;
+	sipblockhash hash;  //siphash_cd_blocks_batch<C,D>
+	std::vector<sipqueue> queue;  //messages of nblock blocks in queue[nblock]
+	unsigned long long output[sipstream_batch];
+};
+
+template<int C,int D>
+static inline void sipstream_init(sipstream &st,const sipctx &ctx)
+{
+	st.ctx = ctx;
+	st.hash = siphash_cd_blocks_batch<C,D>;
+	st.queue.clear();
+}
+
+//hashes the messages of nblock blocks queued so far
+static inline void sipstream_hash(sipstream &st,long long nblock)
+{
+	sipqueue &q = st.queue[nblock];
+	st.hash(st.ctx,q.block.data(),nblock,st.output,q.n);
+	for (long long i=0;i<q.n;i++) *q.out[i] = st.output[i];
+	q.n = 0;
+}
+
+//queues the message of len bytes at data, its output is written to *out at the latest by sipstream_flush
+static inline void sipstream_add(sipstream &st,const unsigned char* data,long long len,unsigned long long* out)
+{
+	long long nblock = sip_blocknum(len);
+	if ((long long)st.queue.size()<=nblock) st.queue.resize(nblock+1);
+	sipqueue &q = st.queue[nblock];
+	if (q.block.empty())
+	{
+		q.n = 0;
+		q.block.resize(sipstream_batch*nblock);
+	}
+	sip_blocks(data,len,&q.block[q.n*nblock]);
+	q.out[q.n++] = out;
+	if (q.n==sipstream_batch) sipstream_hash(st,nblock);
+}
+
+//hashes every queued message
+static inline void sipstream_flush(sipstream &st)
+{
+	for (long long nblock=1;nblock<(long long)st.queue.size();nblock++)
+		if (!st.queue[nblock].block.empty()&&(st.queue[nblock].n>0)) sipstream_hash(st,nblock);
+}
+
+//out[i] = siphash_cd_bytes<C,D>(ctx,data[i],len[i]) for 0<=i<n
+template<int C,int D>
+static inline void siphash_cd_bytes_batch(const sipctx &ctx,const unsigned char* const* data,const long long* len,unsigned long long* out,long long n)
+{
+	sipstream st;
+	sipstream_init<C,D>(st,ctx);
+	for (long long i=0;i<n;i++) sipstream_add(st,data[i],len[i],out+i);
+	sipstream_flush(st);
+}
+
+static inline void siphash_2_1_batch(const sipctx &ctx,const unsigned long long* m,unsigned long long* out,long long n)
+{
+	siphash_cd_batch<2,1>(ctx,m,out,n);
+}
+static inline void siphash_2_2_batch(const sipctx &ctx,const unsigned long long* m,unsigned long long* out,long long n)
+{
+	siphash_cd_batch<2,2>(ctx,m,out,n);
+}
+static inline void siphash_2_1_pair_batch(const sipctx &ctx,const unsigned long long* m,unsigned long long delta,unsigned long long* out,long long n)
+{
+	siphash_cd_pair_batch<2,1>(ctx,m,delta,out,n);
+}
+static inline void siphash_2_2_pair_batch(const sipctx &ctx,const unsigned long long* m,unsigned long long delta,unsigned long long* out,long long n)
+{
+	siphash_cd_pair_batch<2,2>(ctx,m,delta,out,n);
+}
+static inline void siphash_2_1_keys_batch(const unsigned long long* k0,const unsigned long long* k1,unsigned long long m,unsigned long long* out,long long n)
+{
+	siphash_cd_keys_batch<2,1>(k0,k1,m,out,n);
+}
+static inline void siphash_2_2_keys_batch(const unsigned long long* k0,const unsigned long long* k1,unsigned long long m,unsigned long long* out,long long n)
+{
+	siphash_cd_keys_batch<2,2>(k0,k1,m,out,n);
+}
+static inline void siphash_2_1_pair_count(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,unsigned long long outmask,long long* counter)
+{
+	siphash_cd_pair_count<2,1>(ctx,m,n,delta,outmask,counter);
+}
+static inline void siphash_2_2_pair_count(const sipctx &ctx,const unsigned long long* m,long long n,unsigned long long delta,unsigned long long outmask,long long* counter)
+{
+	siphash_cd_pair_count<2,2>(ctx,m,n,delta,outmask,counter);
+}
+
+#endif
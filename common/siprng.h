@@ -0,0 +1,144 @@
+/*
+	Counter-Based Random Generator - Keys and Messages
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This header replaces simple_ran64()/rand() in the data generation and key recovery programs.
+	Every random value is a pure function of (seed, key index, sample index):
+		stream = mix(mix(seed)^((2*keyindex+domain+1)*gamma))  //domain 0 for the key, 1 for the messages
+		value  = mix(stream+(sampleindex+1)*gamma)  //SplitMix64 output function on a Weyl counter
+	so there is no hidden state, any thread or shard can jump to its own part of the data, \
+	  and any single key (with all its messages) can be regenerated from the seed and its index.
+	Batches of messages are produced 4 (AVX2) or 8 (AVX-512) at a time, with the same dispatch as siphash_simd.h.
+
+	The seed is taken from the environment variable SIPHASH_SEED if it is set (decimal or 0x-prefixed hex), \
+	  otherwise from std::random_device and the high resolution clock, so jobs started in the same second differ.
+	Programs print the seed they use, so that a run can be replayed with SIPHASH_SEED.
+
+	Usage:
+		unsigned long long seed = sip_rng_seed();
+		sipkey key = sip_rng_key(seed,keycount);
+		unsigned long long stream = sip_rng_stream(seed,keycount,SIP_RNG_MESSAGE);
+		sip_ran64_batch(stream,inputcount,message,num);  //message[b] = sip_ran64(stream,inputcount+b)
+*/
+
+#ifndef SIPRNG_H
+#define SIPRNG_H
+
+#include<cstdlib>
+#include<chrono>
+#include<random>
+#include"siphash_simd.h"
+
+const unsigned long long sip_rng_gamma = 0x9e3779b97f4a7c15;  //2^64/golden ratio
+const unsigned long long sip_rng_m1 = 0xbf58476d1ce4e5b9;
+const unsigned long long sip_rng_m2 = 0x94d049bb133111eb;
+
+enum {SIP_RNG_KEY = 0,SIP_RNG_MESSAGE = 1};
+
+static inline unsigned long long sip_mix64(unsigned long long z)
+{
+	z = (z^(z>>30))*sip_rng_m1;
+	z = (z^(z>>27))*sip_rng_m2;
+	return z^(z>>31);
+}
+
+static inline unsigned long long sip_rng_seed()
+{
+	const char* env = getenv("SIPHASH_SEED");
+	if (env!=NULL) return strtoull(env,NULL,0);
+	std::random_device rd;
+	unsigned long long seed = ((unsigned long long)rd()<<32)^rd();
+	seed ^= (unsigned long long)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+	return sip_mix64(seed);
+}
+
+static inline unsigned long long sip_rng_stream(unsigned long long seed,long long keyindex,int domain)
+{
+	return sip_mix64(sip_mix64(seed)^((2*(unsigned long long)keyindex+domain+1)*sip_rng_gamma));
+}
+
+static inline unsigned long long sip_ran64(unsigned long long stream,long long sampleindex)
+{
+	return sip_mix64(stream+((unsigned long long)sampleindex+1)*sip_rng_gamma);
+}
+
+static inline sipkey sip_rng_key(unsigned long long seed,long long keyindex)
+{
+	unsigned long long stream = sip_rng_stream(seed,keyindex,SIP_RNG_KEY);
+	sipkey key;
+	key.k0 = sip_ran64(stream,0);
+	key.k1 = sip_ran64(stream,1);
+	return key;
+}
+
+#ifdef SIPHASH_SIMD_X86
+
+//low 64 bits of a*b, from 32x32->64 multiplies
+__attribute__((target("avx2"))) static inline __m256i sip_mullo_avx2(__m256i a,__m256i b)
+{
+	__m256i lo = _mm256_mul_epu32(a,b);
+	__m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a,32),b),_mm256_mul_epu32(a,_mm256_srli_epi64(b,32)));
+	return _mm256_add_epi64(lo,_mm256_slli_epi64(cross,32));
+}
+__attribute__((target("avx2"))) static inline __m256i sip_mix64_avx2(__m256i z)
+{
+	z = sip_mullo_avx2(_mm256_xor_si256(z,_mm256_srli_epi64(z,30)),_mm256_set1_epi64x(sip_rng_m1));
+	z = sip_mullo_avx2(_mm256_xor_si256(z,_mm256_srli_epi64(z,27)),_mm256_set1_epi64x(sip_rng_m2));
+	return _mm256_xor_si256(z,_mm256_srli_epi64(z,31));
+}
+__attribute__((target("avx2"))) static long long sip_ran64_batch_avx2(unsigned long long stream,long long start,unsigned long long* out,long long n)
+{
+	__m256i step = _mm256_set1_epi64x(4*sip_rng_gamma);
+	unsigned long long first = stream+((unsigned long long)start+1)*sip_rng_gamma;
+	__m256i x = _mm256_setr_epi64x(first,first+sip_rng_gamma,first+2*sip_rng_gamma,first+3*sip_rng_gamma);
+	long long i = 0;
+	for (;i+4<=n;i+=4)
+	{
+		_mm256_storeu_si256((__m256i*)(out+i),sip_mix64_avx2(x));
+		x = _mm256_add_epi64(x,step);
+	}
+	return i;
+}
+
+//maskz forms of the intrinsics avoid a false -Wmaybe-uninitialized of GCC 12
+__attribute__((target("avx512f"))) static inline __m512i sip_mullo_avx512(__m512i a,__m512i b)
+{
+	__m512i lo = _mm512_maskz_mul_epu32(0xff,a,b);
+	__m512i cross = _mm512_add_epi64(_mm512_maskz_mul_epu32(0xff,_mm512_maskz_srli_epi64(0xff,a,32),b),_mm512_maskz_mul_epu32(0xff,a,_mm512_maskz_srli_epi64(0xff,b,32)));
+	return _mm512_add_epi64(lo,_mm512_maskz_slli_epi64(0xff,cross,32));
+}
+__attribute__((target("avx512f"))) static inline __m512i sip_mix64_avx512(__m512i z)
+{
+	z = sip_mullo_avx512(_mm512_xor_si512(z,_mm512_maskz_srli_epi64(0xff,z,30)),_mm512_set1_epi64(sip_rng_m1));
+	z = sip_mullo_avx512(_mm512_xor_si512(z,_mm512_maskz_srli_epi64(0xff,z,27)),_mm512_set1_epi64(sip_rng_m2));
+	return _mm512_xor_si512(z,_mm512_maskz_srli_epi64(0xff,z,31));
+}
+__attribute__((target("avx512f"))) static long long sip_ran64_batch_avx512(unsigned long long stream,long long start,unsigned long long* out,long long n)
+{
+	__m512i step = _mm512_set1_epi64(8*sip_rng_gamma);
+	unsigned long long first = stream+((unsigned long long)start+1)*sip_rng_gamma;
+	__m512i x = _mm512_set_epi64(first+7*sip_rng_gamma,first+6*sip_rng_gamma,first+5*sip_rng_gamma,first+4*sip_rng_gamma,first+3*sip_rng_gamma,first+2*sip_rng_gamma,first+sip_rng_gamma,first);
+	long long i = 0;
+	for (;i+8<=n;i+=8)
+	{
+		_mm512_storeu_si512((void*)(out+i),sip_mix64_avx512(x));
+		x = _mm512_add_epi64(x,step);
+	}
+	return i;
+}
+
+#endif
+
+//out[b] = sip_ran64(stream,start+b) for b<n
+static inline void sip_ran64_batch(unsigned long long stream,long long start,unsigned long long* out,long long n)
+{
+	long long i = 0;
+#ifdef SIPHASH_SIMD_X86
+	int level = sip_simd_level();
+	if (level==SIP_AVX512) i = sip_ran64_batch_avx512(stream,start,out,n);
+	else if (level==SIP_AVX2) i = sip_ran64_batch_avx2(stream,start,out,n);
+#endif
+	for (;i<n;i++) out[i] = sip_ran64(stream,start+i);
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+	Thread Pool - Parallel Key Loops with Ordered Output
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This header spreads the independent iterations of a loop (keys, or chunks of samples) across threads.
+	Iterations are handed out one at a time from a shared counter, so a thread that finishes early simply takes the next one.
+	Results that finish out of order can be passed through a sip_ordered, which hands them back strictly in index order \
+	  as soon as every earlier index is done, so output files do not depend on the number of threads.
+	Programs using this header must be compiled with -pthread.
+
+	Usage:
+		int nthread = sip_parse_threads(argc,argv);  //removes "-j N" from the operational parameters
+		sip_ordered ord(keynum);
+		sip_parallel_for(nthread,keynum,[&](long long keycount,int thread)
+		{
+			...  //compute result[keycount], thread-private buffers indexed by thread
+			sip_ordered_done(ord,keycount,[&](long long i){write(result[i]);});
+		});
+*/
+
+#ifndef SIPTHREAD_H
+#define SIPTHREAD_H
+
+#include<cstdlib>
+#include<cstring>
+#include<atomic>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+//"-j N" anywhere in argv: N threads, "-j 0": one thread per core, absent: 1 thread
+static inline int sip_parse_threads(int &argc,char* argv[])
+{
+	int nthread = 1;
+	for (int i=1;i<argc;i++)
+	{
+		if (strcmp(argv[i],"-j")!=0) continue;
+		if (i+1<argc) nthread = atoi(argv[i+1]);
+		int skip = (i+1<argc)?2:1;
+		for (int j=i;j+skip<=argc;j++) argv[j] = argv[j+skip];
+		argc -= skip;
+		break;
+	}
+	if (nthread<=0) nthread = std::thread::hardware_concurrency();
+	if (nthread<=0) nthread = 1;
+	return nthread;
+}
+
+//f(i,thread) for every first<=i<n, thread in 0..nthread-1
+template<typename F>
+static void sip_parallel_for(int nthread,long long first,long long n,F f)
+{
+	if (nthread<=1)
+	{
+		for (long long i=first;i<n;i++) f(i,0);
+		return;
+	}
+	std::atomic<long long> next(first);
+	std::vector<std::thread> pool;
+	for (int t=0;t<nthread;t++)
+		pool.push_back(std::thread([&,t]()
+		{
+			for (long long i=next++;i<n;i=next++) f(i,t);
+		}));
+	for (int t=0;t<nthread;t++) pool[t].join();
+}
+template<typename F>
+static void sip_parallel_for(int nthread,long long n,F f)
+{
+	sip_parallel_for(nthread,0,n,f);
+}
+
+struct sip_ordered
+{
+	std::mutex lock;
+	std::vector<char> done;
+	long long next;
+	sip_ordered(long long n,long long first = 0) : done(n,0),next(first) {}
+};
+
+//mark index i as finished, then call f(j) in order for every j whose predecessors are all finished
+template<typename F>
+static void sip_ordered_done(sip_ordered &ord,long long i,F f)
+{
+	std::lock_guard<std::mutex> guard(ord.lock);
+	ord.done[i] = 1;
+	while ((ord.next<(long long)ord.done.size())&&ord.done[ord.next])
+	{
+		f(ord.next);
+		ord.next++;
+	}
+}
+
+#endif
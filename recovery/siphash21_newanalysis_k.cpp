@@ -11,9 +11,17 @@
 	
 	Program must be executed with 2 operational parameters k(operational parameter) and n(operational parameter), \
 	  with file "sip21test_k_n.txt" existing under directory "./data".
+	If "sip21test_k_n.bin" (written by the Data Generation Program, or converted from the text file by common/bias_convert.cpp) \
+	  is also there, it is loaded instead through mmap, which takes milliseconds instead of parsing the text file.
 	i.e.:
 		./siphash21_newanalysis_k 07 0
 		./siphash21_newanalysis_k 43 1
+	The keys of each output bit are counted into a histogram of their biases (common/biashist.h) instead of being sorted, \
+	  and the best boundline of every output bit is found in one sweep over its histogram (biascond in common/biasanalysis.h).
+	Option "-j N" analyses N output bits at the same time on N threads ("-j 0": one thread per core); \
+	  the outputs do not depend on N, and the program must be compiled with -pthread.
+	i.e.:
+		./siphash21_newanalysis_k 07 0 -j 0
 	
 	Output Format
 		Program only produces standard outputs.
@@ -49,39 +57,20 @@
 #include<cstdlib>
 #include<cstring>
 #include<cmath>
+#include"../common/biasstore.h"
+#include"../common/biasanalysis.h"
+#include"../common/sipthread.h"
 using namespace std;
 
 const int keynum = 2*4096;
 
-struct testdata
-{
-	double bias;
-	int flag;
-};
-testdata data[64][keynum];
+short biasdata[64][keynum];//bias*100 of output bit j of key i, as the two decimals of the data file
 
 void initdata()
 {
 	for (int i=0;i<64;i++)
-	{
 		for (int j=0;j<keynum;j++)
-		{
-			data[i][j].bias = 0.0;
-			data[i][j].flag = -1;
-		}
-	}
-}
-
-void sortdata(int k)
-{
-	for (int i=0;i<keynum-1;i++)
-		for (int j=i+1;j<keynum;j++)
-			if (data[k][i].bias>data[k][j].bias)
-			{
-				testdata temp = data[k][i];
-				data[k][i] = data[k][j];
-				data[k][j] = temp;
-			}
+			biasdata[i][j] = 0;
 }
 
 void loaddata(char* name)
@@ -92,27 +81,36 @@ void loaddata(char* name)
 	for (int i=0;i<keynum;i++)
 	{
 		string key1,key2;
-		int site,flag;
+		int site;
 		double bias;
 		fin>>key1;
 		fin>>key2;
-		flag = i/(keynum/2);
 		for (int j=0;j<64;j++)
 		{
 			fin>>site;
 			fin>>bias;
-			data[j][i].bias = bias;
-			data[j][i].flag = flag;
+			biasdata[j][i] = (short)lround(bias*100);
 		}
 	}
 	fin.close();
 	cout<<"load "<<name<<" finished\n";
 }
 
-double myabs(double a)
+//the same data from the binary file written next to the text file, false if it is missing or of another run
+bool loadbin(char* name)
 {
-	if (a>0) return a;
-	else return -a;
+	biasstore st;
+	if (!biasstore_open(name,st)) return false;
+	if ((st.head->variant!=SIPBIAS_NEWCONDTEST)||(st.head->keynum!=keynum))
+	{
+		biasstore_close(st);
+		return false;
+	}
+	initdata();
+	for (int j=0;j<64;j++) memcpy(biasdata[j],st.column+(long long)j*keynum,keynum*sizeof(short));
+	biasstore_close(st);
+	cout<<"load "<<name<<" finished\n";
+	return true;
 }
 
 int chartoint(char* s)
@@ -125,6 +123,7 @@ int chartoint(char* s)
 
 int main(int argc, char* argv[])
 {
+	int nthread = sip_parse_threads(argc,argv);
 	//filename
 	char filename[40] = "./data/sip21test_";
 	strcat(filename,argv[1]);
@@ -132,103 +131,19 @@ int main(int argc, char* argv[])
 	strcat(filename,argv[2]);
 	strcat(filename,".txt");
 	int n = chartoint(argv[2]);
-	loaddata(filename);
-	//analyze
-	int maxj = -1;
-	double maxp = 0;
-	double maxleftbound = 0.0;
-	double maxrightbound = 0.0;
-	int bestjlist[64];
-	double bestboundleftlist[64];
-	double bestboundrightlist[64];
-	for (int i=0;i<64;i++)
-	{
-		bestjlist[i] = 0;
-		bestboundleftlist[i] = 0;
-		bestboundrightlist[i] = 0;
-	}
-	int bestlist_i = -1;
-	for (int j=0;j<64;j++)
-	{
-		sortdata(j);
-		double maxp_ofj = 0;
-		double maxboundleft_ofj = 0.0;
-		double maxboundright_ofj = 0.0;
-		int p0 = 0;
-		int q0 = 0;
-		for (int i=0;i<keynum;i++)
-		{
-			if (data[j][i].flag==0) p0++;
-			if (data[j][i].flag==1) q0++;
-			if (data[j][i].bias<-9) continue;
-			if ((i<keynum-1)&&(data[j][i+1].bias==data[j][i].bias)) continue;
-			double pp0 = p0*1.0/(keynum/2);
-			double qq0 = q0*1.0/(keynum/2);
-			double p = (1+myabs(pp0-qq0))/2;
-			if (p>maxp_ofj)
-			{
-				maxp_ofj = p;
-				maxboundleft_ofj = data[j][i].bias;
-				if (i==keynum-1) maxboundright_ofj = data[j][i].bias+0.01;
-				else maxboundright_ofj = data[j][i+1].bias;
-			}
-		}
-		printf("site:%d bound:%.3f p:%.3f\n",j,(maxboundleft_ofj+maxboundright_ofj)/2,maxp_ofj);
-		if (myabs(1-maxp_ofj)<1e-6)
-		{
-			bestlist_i++;
-			bestjlist[bestlist_i] = j;
-			bestboundleftlist[bestlist_i] = maxboundleft_ofj;
-			bestboundrightlist[bestlist_i] = maxboundright_ofj;
-		}
-		if (maxp_ofj>maxp)
-		{
-			maxj = j;
-			maxp = maxp_ofj;
-			maxleftbound = maxboundleft_ofj;
-			maxrightbound = maxboundright_ofj;
-		}
-	}
-	printf("\n");
-	printf("best choices:\n");
-	if (bestlist_i!=-1)
-	{
-		for (int j=0;j<=bestlist_i;j++)
-		{
-			printf("site:%d midbound:%.3f leftbound:%.3f rightbound:%.3f\n",bestjlist[j],(bestboundleftlist[j]+bestboundrightlist[j])/2,bestboundleftlist[j],bestboundrightlist[j]);
-			int maxp0 = 0;
-			int maxq0 = 0;
-			for (int i=0;i<keynum;i++)
-			{
-				if (data[bestjlist[j]][i].bias<(bestboundleftlist[j]+bestboundrightlist[j])/2)
-				{
-					if (data[bestjlist[j]][i].flag==0) maxp0++;
-					if (data[bestjlist[j]][i].flag==1) maxq0++;
-				}
-			}
-			double maxpp0 = maxp0*1.0/(keynum/2);
-			double maxqq0 = maxq0*1.0/(keynum/2);
-			if (n==0) printf("p1:%.3f p2:%.3f p_v2[k]:%.3f\n",maxpp0,maxqq0,(1+myabs(maxpp0-maxqq0))/2);
-			if (n==1) printf("q1:%.3f q2:%.3f p_v2[k]:%.3f\n",maxpp0,maxqq0,(1+myabs(maxpp0-maxqq0))/2);
-		}
-	}
-	else
+	char binname[40];
+	strcpy(binname,filename);
+	strcpy(binname+strlen(binname)-4,".bin");
+	if (!loadbin(binname)) loaddata(filename);
+	//analyze (common/biasanalysis.h)
+	biascond c;
+	biascond_init(c,2,keynum);
+	for (int i=0;i<keynum;i++)
 	{
-		printf("site:%d midbound:%.3f leftbound:%.3f rightbound:%.3f\n",maxj,(maxleftbound+maxrightbound)/2,maxleftbound,maxrightbound);
-		int maxp0 = 0;
-		int maxq0 = 0;
-		for (int i=0;i<keynum;i++)
-		{
-			if (data[maxj][i].bias<(maxleftbound+maxrightbound)/2)
-			{
-				if (data[maxj][i].flag==0) maxp0++;
-				if (data[maxj][i].flag==1) maxq0++;
-			}
-		}
-		double maxpp0 = maxp0*1.0/(keynum/2);
-		double maxqq0 = maxq0*1.0/(keynum/2);
-		if (n==0) printf("p1:%.3f p2:%.3f p_v2[k]:%.3f\n",maxpp0,maxqq0,maxp);
-		if (n==1) printf("q1:%.3f q2:%.3f p_v2[k]:%.3f\n",maxpp0,maxqq0,maxp);
+		short fixed[64];
+		for (int j=0;j<64;j++) fixed[j] = biasdata[j][i];
+		biascond_add(c,i,fixed);
 	}
+	biascond_print(c,n,stdout,nthread);
 	return 0;
 }
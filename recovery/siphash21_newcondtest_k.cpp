@@ -7,6 +7,8 @@
 	For each key, program randomly chooses inputnum(internal parameter) pairs of input message differing on bit k(operational parameter), \
 	  or say input1^input2 = 1<<k, and calculates corresponding biases of all 64 output bits.
 	All input messages are restricted into one 64-bit block.
+	Keys and messages are drawn from the counter-based generator in common/siprng.h, indexed by (seed, key index, message index).
+	The seed is printed on start; a run can be replayed with the environment variable SIPHASH_SEED set to it.
 	*In this version, input messages are set to meet the padding rules, which means all messages are in the form of 0x07??????????????
 	Those internal parameters can be directly modified in the first page, \
 	  but the authors still suggest the original version inputnum = 1048576 and keynum = 4096.
@@ -16,6 +18,21 @@
 	i.e.:
 		./siphash21_newcondtest_k 07 0
 		./siphash21_newcondtest_k 43 1
+	Options "-j N" (threads), "--resume" (checkpoints), "--shard i" and "--extend N" (runs over more messages) \
+	  and "--stream" (statistics of siphash21_newanalysis_k.cpp without the text file) are those of all the generators, see common/biasrun.h.
+	i.e.:
+		./siphash21_newcondtest_k 07 0 -j 16 --resume
+		SIPHASH_SEED=0x1234 ./siphash21_newcondtest_k 07 0 -j 16 --shard 1
+		./siphash21_newcondtest_k 07 0 -j 16 --extend 15728640
+		./siphash21_newcondtest_k 07 0 -j 16 --stream
+	Option "--masks file" replaces the input bit k by the input masks and the 64 output bits by the output masks listed in the file \
+	  (common/maskcounter.h), on the same classified keys and conditioned messages as without the option; \
+	  it goes with "-j N" and "--shard i" only (see common/biasrun.h).
+	The conditions are set on the first message of each pair, so input masks should leave bit k-1 and bits 56~63 (the padding byte 0x07) alone, as bit k does.
+	The output file is "sip21mask_k_n_file", in the format of siphash21_biastest with "--masks", \
+	  with the keys in the same order as "sip21test_k_n.txt" (first keynum keys in Group 1, and so on).
+	i.e.:
+		./siphash21_newcondtest_k 07 0 -j 16 --masks masks.txt
 	
 	Keys are classified by the values of v2[k], v2[k-1] and v3[k-1] (after initialization):
 		In case n = 0,
@@ -30,6 +47,9 @@
 		Each output file records the information of 2*keynum keys, where first keynum keys belong to Group 1, and so on.
 		Each key contains 66 lines of information, \
 		  with 2 lines of key information (64-bit per line) and 64 lines of bias information (one output bit per line).
+		The same results are also written to "sip21test_k_n.bin" in the binary columnar format of common/biasstore.h, \
+		  which the analysis program loads much faster than the text file, \
+		  together with the raw counters of every key and output bit, so that runs can be merged or extended later.
 		Each line of bias information contains 2 number, the former is the output bit and the latter is the output bias (exponential part).
 	i.e.:
 		1234567890abcdef
@@ -51,13 +71,17 @@
 #include<cstdlib>
 #include<cstring>
 #include<ctime>
+#include"../common/siphash_simd.h"
+#include"../common/bitcounter.h"
+#include"../common/biasrun.h"
 
 using namespace std;
 
 //internal parameters
 long long inputnum = 1048576;//2^20
-long long halfinputnum = 524288;
 int keynum = 4096;
+int checkpointinterval = 60;//seconds between checkpoints
+const int batchnum = 256;//messages per SIMD batch
 //internal parameters
 
 unsigned long long leftrotate(unsigned long long a,int length)  //64-bit left-rotate 
@@ -80,30 +104,9 @@ unsigned long long flip_pos_i(unsigned long long a,int i)  //64-bit flip-bit
 }
 
 
-unsigned long long simple_ran64()  //64-bit randomize
-{
-	//modular different Mersenne Prime to avoid circulation
-	unsigned long long u,v,w,x,y,z;
-	u = rand()%31;
-	v = rand()%127;
-	w = rand()%8191;
-	x = rand()%8191;
-	y = rand()%8191;
-	z = rand()%8191;
-	return ((u<<59)|(v<<52)|(w<<39)|(x<<26)|(y<<13)|z);
-}
-unsigned long long simple_ran56_withpadding() //56-bit randomize
+unsigned long long withpadding(unsigned long long a) //keep 56 random bits as a 7-byte message, padding byte 0x07 (see sip_pad in common/siphash.h)
 {
-	//modular different Mersenne Prime to avoid circulation
-	unsigned long long u,v,w,x,y,z,pad;
-	u = rand()%31;
-	v = rand()%31;
-	w = rand()%127;
-	x = rand()%8191;
-	y = rand()%8191;
-	z = rand()%8191;
-	pad = 7;
-	return ((pad<<56)|(u<<51)|(v<<46)|(w<<39)|(x<<26)|(y<<13)|z);
+	return sip_pad(a,7);
 }
 
 void print_longlong_in_binary(unsigned long long a)
@@ -124,65 +127,6 @@ void fprint_longlong_in_hex(unsigned long long a,FILE* fout)
 	fprintf(fout,"%08x%08x\n",left32,right32);
 }
 
-//siphash
-unsigned long long key1,key2;
-unsigned long long ff = 0x00000000000000ff;
-unsigned long long h[4] = {0x736f6d6570736575,0x646f72616e646f6d,0x6c7967656e657261,0x7465646279746573};
-unsigned long long v[4];
-unsigned long long siphash_2_1(unsigned long long m)
-{
-	//init
-	v[0] = h[0]^key1;
-	v[1] = h[1]^key2;
-	v[2] = h[2]^key1;
-	v[3] = h[3]^key2;
-	//init
-	//2-round compression
-	v[3] = v[3]^m;
-	for (int i=1;i<=2;i++)
-	{
-		v[0] = v[0]+v[1];
-		v[2] = v[2]+v[3];
-		v[1] = leftrotate(v[1],13);
-		v[3] = leftrotate(v[3],16);
-		v[1] = v[0]^v[1];
-		v[3] = v[2]^v[3];
-		v[0] = leftrotate(v[0],32);
-		//halfround
-		v[2] = v[1]+v[2];
-		v[0] = v[0]+v[3];
-		v[1] = leftrotate(v[1],17);
-		v[3] = leftrotate(v[3],21);
-		v[1] = v[1]^v[2];
-		v[3] = v[0]^v[3];
-		v[2] = leftrotate(v[2],32);
-	}
-	v[0] = v[0]^m;
-	//2-round compression
-	//1-round finalization
-	v[2] = v[2]^ff;
-	for (int i=1;i<=1;i++)
-	{
-		v[0] = v[0]+v[1];
-		v[2] = v[2]+v[3];
-		v[1] = leftrotate(v[1],13);
-		v[3] = leftrotate(v[3],16);
-		v[1] = v[0]^v[1];
-		v[3] = v[2]^v[3];
-		v[0] = leftrotate(v[0],32);
-		//halfround
-		v[2] = v[1]+v[2];
-		v[0] = v[0]+v[3];
-		v[1] = leftrotate(v[1],17);
-		v[3] = leftrotate(v[3],21);
-		v[1] = v[1]^v[2];
-		v[3] = v[0]^v[3];
-		v[2] = leftrotate(v[2],32);
-	}
-	//1-round finalization
-	return (v[0]^v[1]^v[2]^v[3]);
-} 
-//siphash
 
 char knum[10];
 void myitoa(int k)
@@ -201,60 +145,72 @@ int chartoint(char* s)
 
 int main(int argc, char* argv[])
 {
-	srand((int)time(0));
-	long long counter[64];//output differential counter
+	biasrun r;
+	biasrun_options(r,argc,argv);
 	//load k and n
 	int k = chartoint(argv[1]);
 	int n = chartoint(argv[2]);
 	if ((k<1)||(k>63)||(n<0)||(n>1)) return -1;//k:1~63 && n:0~1
-	//filename
-	char filename[20] = "sip21test_";
-	strcat(filename,argv[1]);
-	strcat(filename,"_");
-	strcat(filename,argv[2]);
-	strcat(filename,".txt");
-	FILE* fout = fopen(filename,"w");
-	//test for the k-th input differential bit
-	for (int keycount=0;keycount<2*keynum;keycount++)
+	//program and output files
+	char program[40] = "siphash21_newcondtest_k ";
+	strcat(program,argv[1]);
+	strcat(program," ");
+	strcat(program,argv[2]);
+	char name[20] = "sip21test_";
+	strcat(name,argv[1]);
+	strcat(name,"_");
+	strcat(name,argv[2]);
+	char maskprefix[40] = "sip21mask_";
+	strcat(maskprefix,argv[1]);
+	strcat(maskprefix,"_");
+	strcat(maskprefix,argv[2]);
+	strcat(maskprefix,"_");
+	if (r.maskname!=NULL)
+	{
+		if (!biasrun_start_masks(r,maskprefix,2*keynum,inputnum)) return -1;
+	}
+	else if (!biasrun_start(r,program,name,SIPBIAS_NEWCONDTEST,k,n,2,2*keynum,inputnum,checkpointinterval)) return -1;
+	//test for the k-th input differential bit, keys spread over the threads
+	biasrun_keys(r,[&](long long keycount,sipkey &key,long long* counter)
 	{
+		bitcounter bc;//vertical accumulator of counter
+		unsigned long long message[batchnum],diffrence[batchnum];
 		//init
-		for (int j=0;j<64;j++) counter[j] = 0;
-		key1 = simple_ran64();
-		key2 = simple_ran64();
+		bitcounter_init(bc);
+		key = sip_rng_key(r.seed,keycount);
+		unsigned long long stream = sip_rng_stream(r.seed,keycount,SIP_RNG_MESSAGE);
 		//classify
-		if (get_pos_i(h[2]^key1,k-1)!=n) key1 = flip_pos_i(key1,k-1);//v2[k-1] = n
+		if (get_pos_i(sip_h[2]^key.k0,k-1)!=n) key.k0 = flip_pos_i(key.k0,k-1);//v2[k-1] = n
 		int flag = keycount/keynum;
 		if (flag==0)
-			if (get_pos_i(h[2]^key1,k)!=0) key1 = flip_pos_i(key1,k);//v2[k] = 0
+			if (get_pos_i(sip_h[2]^key.k0,k)!=0) key.k0 = flip_pos_i(key.k0,k);//v2[k] = 0
 		if (flag==1)
-			if (get_pos_i(h[2]^key1,k)!=1) key1 = flip_pos_i(key1,k);//v2[k] = 1
+			if (get_pos_i(sip_h[2]^key.k0,k)!=1) key.k0 = flip_pos_i(key.k0,k);//v2[k] = 1
+		sipctx ctx = sip_prepare(key);
 		//test
-		for (int inputcount=1;inputcount<=inputnum;inputcount++)
+		for (long long inputcount=0;inputcount<r.inputnum;inputcount+=batchnum)
 		{
-			unsigned long long message = simple_ran56_withpadding();
-			if (n==0)
-				if (get_pos_i(h[3]^key2^message,k-1)!=0) message = flip_pos_i(message,k-1);//v3[k-1] = 0
-			if (n==1)
-				if (get_pos_i(h[3]^key2^message,k-1)!=1) message = flip_pos_i(message,k-1);//v3[k-1] = 1
-			unsigned long long message_pie = flip_pos_i(message,k);
-			unsigned long long output = siphash_2_1(message);
-			unsigned long long output_pie = siphash_2_1(message_pie);
-			unsigned long long diffrence = output^output_pie;
-			for (int j=0;j<64;j++)
-				if (get_pos_i(diffrence,j)==1) counter[j]++;
+			int num = batchnum;
+			if (r.inputnum-inputcount<num) num = r.inputnum-inputcount;
+			sip_ran64_batch(stream,r.first+inputcount,message,num);
+			for (int b=0;b<num;b++)
+			{
+				message[b] = withpadding(message[b]);
+				if (n==0)
+					if (get_pos_i(sip_h[3]^key.k1^message[b],k-1)!=0) message[b] = flip_pos_i(message[b],k-1);//v3[k-1] = 0
+				if (n==1)
+					if (get_pos_i(sip_h[3]^key.k1^message[b],k-1)!=1) message[b] = flip_pos_i(message[b],k-1);//v3[k-1] = 1
+			}
+			if (r.maskname!=NULL)
+			{
+				siphash_2_1_mask_count(ctx,r.ms,message,num,counter);
+				continue;
+			}
+			siphash_2_1_pair_batch(ctx,message,flip_pos_i(0,k),diffrence,num);
+			bitcounter_add(bc,diffrence,num);
 		}
-		//output
-		fprint_longlong_in_hex(key1,fout);
-		fprint_longlong_in_hex(key2,fout);
-		for (int j=0;j<64;j++)
-		{
-			if (j>9) fprintf(fout,"%d ",j);
-			else fprintf(fout,"0%d ",j);
-			if (counter[j]==halfinputnum) fprintf(fout,"-21.00\n");
-			else fprintf(fout,"%.2f\n",log(abs(counter[j]-halfinputnum))/log(2)-log(inputnum)/log(2));
-		}
-		fprintf(fout,"\n");
-	}
-	fclose(fout);
+		if (r.maskname==NULL) bitcounter_flush(bc,counter);
+	});
+	biasrun_finish(r);
 	return 0;
-} 
+}
@@ -13,6 +13,76 @@
 	  the recovery program is truncatedly failed.
 	
 	Program can be directly executed without any operational parameters.
+	Option "-j N" recovers N keys at the same time on N threads ("-j 0": one thread per core), \
+	  each thread keeping its own statistics; keys are still written in order, so "output.txt" does not depend on N.
+	The program must be compiled with -pthread.
+	i.e.:
+		./siphash21_recovery_56bit -j 0
+	Option "--adaptive" spends the pairs of each key where they are needed instead of inputnum pairs on every test: \
+	  in rounds of stepnum(internal parameter) pairs per test, every test whose decision is not settled yet gets one more batch, \
+	  until it is settled, or it reaches maxinputnum pairs, or the key reaches budgetnum pairs (internal parameters).
+	A decision is settled when the bias measured on n pairs after t rounds is more than sqrt(ln(2t(t+1)/significance)/2n) away from 2^bound, \
+	  which holds at all t at the same time except with probability significance(internal parameter) per test (Hoeffding bound, with a union bound over the checks).
+	Tests far from their bound settle within a few rounds, so the average data complexity per key is lower than 111*inputnum; \
+	  with maxinputnum = inputnum, test (i,j) uses the first messages of the same range as without the option, \
+	  and larger maxinputnum gives the pairs saved to the tests that stay unsettled.
+	i.e.:
+		./siphash21_recovery_56bit -j 0 --adaptive
+	Option "--soft" replaces the hard predictions by their likelihoods: test (i,j) gives the margin z of its measured bias below 2^bound \
+	  in standard deviations, and -ln(Phi(z)) (or -ln(Phi(-z))) is the cost of guessing that v3[i-1] = j leads to v2[i] = 0 or 1.
+	guesslist[i] only depends on guesslist[i-1] and the tests (i,0),(i,1), so the guesses form a trellis of 2 states per bit, \
+	  and a list Viterbi search keeps the listsize(internal parameter) cheapest paths into each state, \
+	  giving the listsize most likely 56-bit candidates in order; the key is checked against them in this order.
+	The rank of the key is the number of candidates checked, to be compared with the 1, 57 and 1597 candidates \
+	  checked by the hard decision up to 0, 1 and 2 bits missing; it finds more keys at lower rank, and with fewer pairs per test.
+	i.e.:
+		./siphash21_recovery_56bit -j 0 --soft
+	Option "--keys N" recovers N keys instead of keynum.
+	Option "--sweep" measures the success rate for every inputnum = 2^sweeplo to 2^sweephi (internal parameters, 2^10 to 2^20) on the same keys: \
+	  the messages of each test come from a range of 2^sweephi indices, so inputnum = 2^a uses the first 2^a of them, \
+	  and the counts of each test are accumulated once up to 2^sweephi and decoded after every power of 2 \
+	  (all grid points cost as much as the largest one alone); with option "--soft" the key only has to be in the list.
+	With option "--adaptive", grid point 2^a is a run of --adaptive with maxinputnum = 2^a and budgetnum = 111*2^a on the same ranges, \
+	  each grid point counting its own pairs (all of them cost at most twice the largest one), \
+	  and the queries given are the average pairs actually used per key, so the curve is the success rate against the actual queries.
+	Options "--search" and "--guess" do not go with "--sweep".
+	Success rates are given with their 95% Wilson score intervals, and the cheapest inputnum reaching 0.95 is printed.
+	Option "--sweep-keys K1,K2,..." adds the number of keys as a second axis: the sweep runs on the largest count, \
+	  and the table is given again for the first K1, K2, ... keys, showing how the rates and their intervals settle with more keys \
+	  (the smaller counts are prefixes of the larger ones, not independent samples).
+	i.e.:
+		./siphash21_recovery_56bit -j 0 --sweep --keys 100000
+		./siphash21_recovery_56bit -j 0 --sweep-keys 1000,10000,100000
+	Option "--search" completes the attack on every key: the oracle gives tagnum(internal parameter) (message, tag) pairs, \
+	  and each candidate of k_0[0] to k_0[55] is checked in the order of the decoding (plain chain, 1 bit, 2 bits, or the list of --soft) \
+	  by a brute force over the 2^17 unrecovered bits k_0[56] to k_0[63] and k_1[55] to k_1[63], instead of being compared to the key.
+	The 2^17 keys are hashed on the first message in SIMD batches, one key per lane (siphash_2_1_keys_batch in common/siphash_simd.h), \
+	  and only the keys matching its tag are hashed on the other messages, so a key is verified on all 128 bits \
+	  and the time of the complete attack (bias tests, decoding and searches) is measured for each key.
+	i.e.:
+		./siphash21_recovery_56bit -j 0 --soft --search
+	Option "--guess W" simulates the outer loop of the attack over the guesses of k_1, on the last W bits k_1[55-W] to k_1[54] \
+	  (the other bits are taken as known, W = 55 being the real attack; W = 16 to 24 measures the cost per guess).
+	The oracle data do not depend on the guess: test (i,j) under k_1[i-1] = g uses the messages of test (i,j^g) under k_1[i-1] = 0, \
+	  so 111 tests of inputnum pairs are counted once per key and shared by all guesses.
+	Guesses are walked in Gray-code order with k_1[54] flipped most often, so that each guess only redoes the end of the chain: \
+	  the decoding of --soft (list of 1) is updated from the first bit i whose tests changed.
+	Swapping the tests (i,0) and (i,1) mostly mirrors the decoded path at almost the same cost (about 0.14 more per wrong bit on average, \
+	  nothing more for almost half of the bits), so the cost of a guess is no proof of inconsistency, only a weak ranking, \
+	  and the right guess is not the cheapest one but close to it.
+	The cheapest guess is found exactly without trying the guesses, as k_1[i-1] only enters the transition to guesslist[i], \
+	  and a guess is aborted as soon as no completion of k_1[0] to k_1[i-1] can cost less than the cheapest guess plus abortmargin, \
+	  and with it all the following guesses sharing k_1[0] to k_1[i-1].
+	abortmargin is calibrated before the run on calibnum(internal parameter) more keys, as the quantile of the gap \
+	  between the right guess and the cheapest guess that aborts the right guess for abortmiss(internal parameter) of the keys \
+	  (about 1.0 for W = 16, abortmiss = 1% and 2^15 pairs per test, which aborts about 20% of the wrong guesses).
+	Surviving guesses are ranked by cost, and the rank of the right one is the number of guesses to pass on to the search of the remaining bits.
+	The run checks that the right guess is not aborted much more often than abortmiss and that wrong guesses are aborted, \
+	  and exits with 1 if not.
+	i.e.:
+		./siphash21_recovery_56bit -j 0 --guess 20
+	Keys and messages come from common/siprng.h: key i and all of its test messages are determined by the seed and i, \
+	  the seed is printed on start, and SIPHASH_SEED=<seed> replays the run.
 	
 	Output Format
 		One execution will produce one output file named "output.txt".
@@ -21,12 +91,33 @@
 			2nd line: binary 64-bit k_1
 			3rd line: recovered 56-bit k_0 (if succeeds)
 			4th line: predicting process
+			5th line: pairs used by the bias tests of this key (option "--adaptive")
 		There are 4 cases of "predicting process":
 			1. all correct (succeed)
 			2. 1 bit misses (succeed)
 			3. 2 bits miss (succeed)
 			4. over 3 bits miss (fail)
-		Finally the program will print the success rate of all randomized key receovery in the end.
+		With option "--soft", the 4th line gives the rank of the key in the candidate list instead, or "not in list".
+		With option "--search", one more line gives the verified key (k_0 then k_1 in hex), the candidates searched \
+		  and the time of the complete attack on this key (time of its thread, so with at most one thread per core), \
+		  followed by their averages at the end.
+	i.e.:
+		key 4dab24323a53aa2ba0b96b9989073da8 searched 1 time 0.041s
+		With option "--guess W", the 3rd line gives the guesses of k_1, the aborted ones, the surviving ones, \
+		  the rank of the right guess among them by cost (0 if aborted) and its cost, followed by a summary with the time per guess \
+		  (time of each thread, so with at most one thread per core), the rate of wrong guesses aborted and the check.
+	i.e.:
+		guesses 65536 aborted 32768 survivors 32768 rank 1953 cost 0.67
+		With option "--sweep", "output_sweep.txt" is written instead, with one line per inputnum (and key count of --sweep-keys): \
+		  inputnum, queries per key (111*inputnum, or the average pairs used with --adaptive), keys, successes, \
+		  success rate and its 95% interval, and the same on standard output.
+	i.e.:
+		inputnum queries keys success rate low high
+		16384 1818624 300 267 0.8900 0.8495 0.9206
+		32768 3637248 300 296 0.9867 0.9662 0.9948
+		Finally the program will print the success rate of all randomized key receovery in the end \
+		  (with option "--soft", the numbers of keys within ranks 1, 2~57, 58~1597, 1598~listsize and not in list), \
+		  and with option "--adaptive" the average pairs per key (also on standard output, with those of a run without the option).
 */
 
 #include<iostream>
@@ -36,13 +127,36 @@
 #include<cstring>
 #include<cmath>
 #include<ctime>
+#include<vector>
+#include<algorithm>
+#include<chrono>
+#include"../common/siphash_simd.h"
+#include"../common/siprng.h"
+#include"../common/sipthread.h"
+#include"../common/sipcheckpoint.h"
 using namespace std;
 
 //int inputnum = 1048576;//2^20
-//int halfinputnum = 524288;
 int inputnum = 32768;//2^15
-int halfinputnum = 16384;
 int keynum = 10000;
+const int batchnum = 256;//messages per SIMD batch
+bool adaptive = false;//option "--adaptive"
+int stepnum = 1024;//pairs per test and round of --adaptive
+long long maxinputnum = 32768;//2^15, most pairs of one test under --adaptive
+long long budgetnum = 3637248;//111*2^15, most pairs of one key under --adaptive
+double significance = 0.001;//probability that one test of --adaptive stops with a wrong decision
+bool soft = false;//option "--soft"
+int listsize = 4096;//candidates of --soft
+bool searchmode = false;//option "--search"
+const int tagnum = 2;//(message, tag) pairs of the oracle kept for --search
+bool sweep = false;//option "--sweep"
+int sweeplo = 10,sweephi = 20;//--sweep: inputnum = 2^sweeplo to 2^sweephi
+vector<int> sweepkeys;//--sweep: key counts, ascending (option "--sweep-keys", keynum by default)
+long long testrange;//messages of each test (i,j) in the stream: inputnum, maxinputnum (--adaptive) or 2^sweephi (--sweep)
+int guesswidth = 0;//option "--guess W": guess k_1[55-W] to k_1[54]
+double abortmiss = 0.01;//--guess: rate of keys whose right guess may be aborted
+int calibnum = 200;//--guess: keys calibrating abortmargin
+double abortmargin;//--guess: guesses costing more than the cheapest one plus abortmargin are aborted (calibrated)
 
 int jsite[63] = {
 	26,	27,	28,	29,	30,	31,	32,	33,	34,
@@ -139,30 +253,9 @@ unsigned long long flip_pos_i(unsigned long long a,int i)  //64-bit flip-bit
 	return (a^(yi<<i));
 }
 
-unsigned long long simple_ran64() //64-bit randomize
+unsigned long long withpadding(unsigned long long a) //keep 56 random bits as a 7-byte message, padding byte 0x07 (see sip_pad in common/siphash.h)
 {
-	//modular different Mersenne Prime to avoid circulation
-	unsigned long long u,v,w,x,y,z;
-	u = rand()%31;
-	v = rand()%127;
-	w = rand()%8191;
-	x = rand()%8191;
-	y = rand()%8191;
-	z = rand()%8191;
-	return ((u<<59)|(v<<52)|(w<<39)|(x<<26)|(y<<13)|z);
-}
-unsigned long long simple_ran56_withpadding() //56-bit randomize
-{
-	//modular different Mersenne Prime to avoid circulation
-	unsigned long long u,v,w,x,y,z,pad;
-	u = rand()%31;
-	v = rand()%31;
-	w = rand()%127;
-	x = rand()%8191;
-	y = rand()%8191;
-	z = rand()%8191;
-	pad = 7;
-	return ((pad<<56)|(u<<51)|(v<<46)|(w<<39)|(x<<26)|(y<<13)|z);
+	return sip_pad(a,7);
 }
 
 void print_longlong_in_binary(unsigned long long a)
@@ -188,153 +281,215 @@ void fprint_longlong_in_hex(unsigned long long a,FILE* fout)
 	fprintf(fout,"%08x%08x\n",left32,right32);
 }
 
-//siphash
-unsigned long long key1,key2;
-unsigned long long ff = 0x00000000000000ff;
-unsigned long long h[4] = {0x736f6d6570736575,0x646f72616e646f6d,0x6c7967656e657261,0x7465646279746573};
-unsigned long long v[4];
-unsigned long long siphash_2_1(unsigned long long m)
-{
-	//init
-	v[0] = h[0]^key1;
-	v[1] = h[1]^key2;
-	v[2] = h[2]^key1;
-	v[3] = h[3]^key2;
-	//init
-	//2-round compression
-	v[3] = v[3]^m;
-	for (int i=1;i<=2;i++)
-	{
-		v[0] = v[0]+v[1];
-		v[2] = v[2]+v[3];
-		v[1] = leftrotate(v[1],13);
-		v[3] = leftrotate(v[3],16);
-		v[1] = v[0]^v[1];
-		v[3] = v[2]^v[3];
-		v[0] = leftrotate(v[0],32);
-		//halfround
-		v[2] = v[1]+v[2];
-		v[0] = v[0]+v[3];
-		v[1] = leftrotate(v[1],17);
-		v[3] = leftrotate(v[3],21);
-		v[1] = v[1]^v[2];
-		v[3] = v[0]^v[3];
-		v[2] = leftrotate(v[2],32);
-	}
-	v[0] = v[0]^m;
-	//2-round compression
-	//1-round finalization
-	v[2] = v[2]^ff;
-	for (int i=1;i<=1;i++)
-	{
-		v[0] = v[0]+v[1];
-		v[2] = v[2]+v[3];
-		v[1] = leftrotate(v[1],13);
-		v[3] = leftrotate(v[3],16);
-		v[1] = v[0]^v[1];
-		v[3] = v[2]^v[3];
-		v[0] = leftrotate(v[0],32);
-		//halfround
-		v[2] = v[1]+v[2];
-		v[0] = v[0]+v[3];
-		v[1] = leftrotate(v[1],17);
-		v[3] = leftrotate(v[3],21);
-		v[1] = v[1]^v[2];
-		v[3] = v[0]^v[3];
-		v[2] = leftrotate(v[2],32);
-	}
-	//1-round finalization
-	return (v[0]^v[1]^v[2]^v[3]);
-} 
-//siphash
 
-int goalbitlist[64];
-int guesslist[64];
-void getgoalbitlist()
+struct guessstat
 {
-	unsigned long long goal = h[2]^key1;
+	long long guesses,aborted,survivors;
+	long long rank;  //rank of the right guess by cost among the survivors, 0 if aborted
+	double cost;  //cost of the right guess
+	double seconds;  //time of the search, without the oracle data
+};
+
+struct keyresult
+{
+	sipkey key;
+	unsigned long long guess;  //bit i: guesslist[i] of the recovered key, i.e. k_0[i] xor sip_h[2][i] (if succeeds)
+	int outcome;  //0: all correct, 1: 1 bit misses, 2: 2 bit miss, 3: over 3 bits miss (--soft: softname)
+	long long queries;  //pairs used by the bias tests
+	int rank;  //--soft: rank of the key in the candidate list, 0 if not in list
+	guessstat gs;  //--guess
+	sipkey found;  //--search: the verified 128-bit key
+	int searched;  //--search: candidates of k_0[0] to k_0[55] searched, up to the verified one
+	double seconds;  //--search: time of the complete attack on this key
+};
+
+//what a candidate of k_0[0] to k_0[55] is checked against
+struct keycheck
+{
+	int goalbitlist[64];  //the key itself, for the simulation without --search
+	unsigned long long k1;  //--search: known k_1[0] to k_1[54]
+	unsigned long long message[tagnum],tag[tagnum];  //--search: (message, tag) pairs of the oracle
+	sipkey found;
+	int searched;
+};
+const char* outcomename[4] = {"all correct","1 bit misses","2 bit miss","over 3 bits miss"};
+const char* softname[5] = {"rank 1","rank 2~57","rank 58~1597","rank 1598~listsize","not in list"};//ranks 1, 57 and 1597: candidates checked by recover() up to 0, 1 and 2 bits missing
+
+void getgoalbitlist(sipkey key,int* goalbitlist)
+{
+	unsigned long long goal = sip_h[2]^key.k0;
 	for (int i=0;i<64;i++)
 	{
 		goalbitlist[i] = goal%2;
 		goal = goal/2;
 	}
 }
-bool keyoracle() //run behind getgoalbitlist()
+//the 2^17 keys with k_0[0] to k_0[55] of k0 and k_1[0] to k_1[54] of k1, all checked against the first pair in SIMD batches,
+//and the few matches against the other pairs
+bool searchkey(unsigned long long k0,unsigned long long k1,const unsigned long long* message,const unsigned long long* tag,sipkey &found)
+{
+	unsigned long long key0[batchnum],key1[batchnum],output[batchnum];
+	for (long long c=0;c<(1LL<<17);c+=batchnum)
+	{
+		for (int b=0;b<batchnum;b++)
+		{
+			unsigned long long x = c+b;
+			key0[b] = (k0&0x00ffffffffffffff)|((x&0xff)<<56);//k_0[56] to k_0[63]
+			key1[b] = (k1&0x007fffffffffffff)|((x>>8)<<55);//k_1[55] to k_1[63]
+		}
+		siphash_2_1_keys_batch(key0,key1,message[0],output,batchnum);
+		for (int b=0;b<batchnum;b++)
+		{
+			if (output[b]!=tag[0]) continue;
+			sipkey key = {key0[b],key1[b]};
+			bool verified = true;
+			for (int t=1;t<tagnum;t++)
+				if (siphash_2_1(key,message[t])!=tag[t]) verified = false;
+			if (verified)
+			{
+				found = key;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool keyoracle(unsigned long long guess,keycheck &kc) //bit i of guess: guesslist[i]
 {
+	if (searchmode)
+	{
+		kc.searched++;
+		return searchkey(guess^sip_h[2],kc.k1,kc.message,kc.tag,kc.found);
+	}
 	for (int i=0;i<=55;i++)
-		if (guesslist[i]!=goalbitlist[i])
+		if ((int)((guess>>i)&1)!=kc.goalbitlist[i])
 			return false;
 	return true;
 }
+bool keyoracle(const int* guesslist,keycheck &kc)
+{
+	unsigned long long guess = 0;
+	for (int i=0;i<56;i++) guess |= (unsigned long long)guesslist[i]<<i;
+	return keyoracle(guess,kc);
+}
 
-int predictresult[56][2];
-void biastest() //fill predictresult
+//count differences on output bit jsite[i] under v3[i-1] = j (no condition for i = 0) computed with k_1 = k1,
+//for the num messages first..first+num-1 of test (i,j)
+long long testcount(unsigned long long k1,const sipctx &ctx,unsigned long long stream,int i,int j,long long first,long long num)
 {
-	int count = 0;
-	double testbias[56][2];
-	for (int inputcount=1;inputcount<=inputnum;inputcount++)
+	long long counter[64];
+	counter[jsite[i]] = 0;
+	long long range = testrange;//each test (i,j) has its own range of message indices
+	unsigned long long message[batchnum];
+	for (long long inputcount=first;inputcount<first+num;inputcount+=batchnum)
 	{
-		unsigned long long message = simple_ran56_withpadding();
-		unsigned long long message_pie = flip_pos_i(message,0);
-		unsigned long long output = siphash_2_1(message);
-		unsigned long long output_pie = siphash_2_1(message_pie);
-		unsigned long long diffrence = output^output_pie;
-		if (get_pos_i(diffrence,jsite[0])==1) count++;
+		int n = batchnum;
+		if (first+num-inputcount<n) n = first+num-inputcount;
+		sip_ran64_batch(stream,(2*i+j)*range+inputcount,message,n);
+		for (int b=0;b<n;b++)
+		{
+			message[b] = withpadding(message[b]);
+			if ((i>0)&&(j==0))
+				if (get_pos_i(sip_h[3]^k1^message[b],i-1)!=0) message[b] = flip_pos_i(message[b],i-1);//v3[i-1] = 0
+			if ((i>0)&&(j==1))
+				if (get_pos_i(sip_h[3]^k1^message[b],i-1)!=1) message[b] = flip_pos_i(message[b],i-1);//v3[i-1] = 1
+		}
+		siphash_2_1_pair_count(ctx,message,n,flip_pos_i(0,i),flip_pos_i(0,jsite[i]),counter);
 	}
-	if (count==halfinputnum) testbias[0][0] = -21;
-	else testbias[0][0] = log(abs(count-halfinputnum))/log(2)-log(inputnum)/log(2);
-	if (testbias[0][0]<=bound[0][0]) predictresult[0][0] = 1;
-	else predictresult[0][0] = 0;
-	for (int i=1;i<56;i++)
+	return counter[jsite[i]];
+}
+
+int predict(int i,int j,long long count,long long num) //prediction of test (i,j) from count differences out of num pairs
+{
+	double testbias;
+	if (2*count==num) testbias = -21;
+	else testbias = log(fabs(count-num/2.0))/log(2)-log(num)/log(2);
+	if (j==0)
+	{
+		if (testbias<=bound[i][j]) return 1;
+		else return 0;
+	}
+	else
 	{
+		if (testbias<=bound[i][j]) return 0;
+		else return 1;
+	}
+}
+
+double margin(int i,int j,long long count,long long num) //how far the bias of test (i,j) lies below 2^bound, in standard deviations of the measured bias
+{
+	return (pow(2,bound[i][j])-fabs(count-num/2.0)/num)*2*sqrt((double)num);
+}
+
+long long biastest(sipkey key,unsigned long long stream,int predictresult[56][2],double zscore[56][2]) //fill predictresult and zscore, return pairs used
+{
+	sipctx ctx = sip_prepare(key);
+	long long count = testcount(key.k1,ctx,stream,0,0,0,inputnum);
+	predictresult[0][0] = predict(0,0,count,inputnum);
+	zscore[0][0] = margin(0,0,count,inputnum);
+	for (int i=1;i<56;i++)
 		for (int j=0;j<2;j++)
 		{
-			count = 0;
-			for (int inputcount=1;inputcount<=inputnum;inputcount++)
-			{
-				unsigned long long message = simple_ran56_withpadding();
-				if (j==0)
-					if (get_pos_i(h[3]^key2^message,i-1)!=0) message = flip_pos_i(message,i-1);//v3[i-1] = 0	
-				if (j==1)
-					if (get_pos_i(h[3]^key2^message,i-1)!=1) message = flip_pos_i(message,i-1);//v3[i-1] = 1
-				unsigned long long message_pie = flip_pos_i(message,i);
-				unsigned long long output = siphash_2_1(message);
-				unsigned long long output_pie = siphash_2_1(message_pie);
-				unsigned long long diffrence = output^output_pie;
-				if (get_pos_i(diffrence,jsite[i])==1) count++;
-			}
-			if (count==halfinputnum) testbias[i][j] = -21;
-			else testbias[i][j] = log(abs(count-halfinputnum))/log(2)-log(inputnum)/log(2);
-			if (j==0)
-			{
-				if (testbias[i][j]<=bound[i][j]) predictresult[i][j] = 1;
-				else predictresult[i][j] = 0;
-			}
-			if (j==1)
+			count = testcount(key.k1,ctx,stream,i,j,0,inputnum);
+			predictresult[i][j] = predict(i,j,count,inputnum);
+			zscore[i][j] = margin(i,j,count,inputnum);
+		}
+	return 111*(long long)inputnum;
+}
+
+long long biastest_adaptive(sipkey key,unsigned long long stream,int predictresult[56][2],double zscore[56][2],long long maxnum,long long budget) //fill predictresult and zscore, return pairs used
+{
+	sipctx ctx = sip_prepare(key);
+	long long count[56][2],num[56][2];
+	bool decided[56][2];
+	for (int i=0;i<56;i++)
+		for (int j=0;j<2;j++)
+		{
+			count[i][j] = 0;
+			num[i][j] = 0;
+			decided[i][j] = (i==0)&&(j==1);//no test (0,1)
+		}
+	long long used = 0;
+	bool progress = true;
+	while (progress)//one round: stepnum more pairs for every undecided test
+	{
+		progress = false;
+		for (int i=0;i<56;i++)
+			for (int j=0;j<2;j++)
 			{
-				if (testbias[i][j]<=bound[i][j]) predictresult[i][j] = 0;
-				else predictresult[i][j] = 1;
+				if (decided[i][j]||(num[i][j]+stepnum>maxnum)||(used+stepnum>budget)) continue;
+				count[i][j] += testcount(key.k1,ctx,stream,i,j,num[i][j],stepnum);
+				num[i][j] += stepnum;
+				used += stepnum;
+				progress = true;
+				long long t = num[i][j]/stepnum;
+				double radius = sqrt(log(2.0*t*(t+1)/significance)/(2.0*num[i][j]));
+				if (fabs(fabs(count[i][j]-num[i][j]/2.0)/num[i][j]-pow(2,bound[i][j]))>radius) decided[i][j] = true;
 			}
-		}
 	}
+	predictresult[0][0] = predict(0,0,count[0][0],num[0][0]);
+	zscore[0][0] = margin(0,0,count[0][0],num[0][0]);
+	for (int i=1;i<56;i++)
+		for (int j=0;j<2;j++)
+		{
+			predictresult[i][j] = predict(i,j,count[i][j],num[i][j]);
+			zscore[i][j] = margin(i,j,count[i][j],num[i][j]);
+		}
+	return used;
 }
 
-int allcorrect = 0;
-int onebitmisses = 0;
-int twobitmiss = 0;
-int overthreebitmiss = 0;
-void recover(FILE* fout)
+void recover(int predictresult[56][2],keycheck &kc,keyresult &r) //fill r.guess and r.outcome
 {
+	int guesslist[56];
+	r.guess = 0;
 	//all correct
 	guesslist[0] = predictresult[0][0];
 	for (int i=1;i<56;i++) guesslist[i] = predictresult[i][guesslist[i-1]];
-	if (keyoracle())
+	if (keyoracle(guesslist,kc))
 	{
-		allcorrect++;
-		fprintf(fout,"                ");
-		for (int i=55;i>=0;i--) fprintf(fout,"%d",(guesslist[i]+get_pos_i(h[2],i))%2);
-		fprintf(fout,"\n");
-		fprintf(fout,"all correct\n");
+		r.outcome = 0;
+		for (int i=0;i<56;i++) r.guess |= (unsigned long long)guesslist[i]<<i;
 		return;
 	}
 	//1 bit misses
@@ -345,13 +500,10 @@ void recover(FILE* fout)
 		for (int i=1;i<56;i++)
 			if (wrongsite==i) guesslist[i] = 1-predictresult[i][guesslist[i-1]];//regarded as wrong guess
 			else guesslist[i] = predictresult[i][guesslist[i-1]];
-		if (keyoracle())
+		if (keyoracle(guesslist,kc))
 		{
-			onebitmisses++;
-			fprintf(fout,"                ");
-			for (int i=55;i>=0;i--) fprintf(fout,"%d",(guesslist[i]+get_pos_i(h[2],i))%2);
-			fprintf(fout,"\n");
-			fprintf(fout,"1 bit misses\n");
+			r.outcome = 1;
+			for (int i=0;i<56;i++) r.guess |= (unsigned long long)guesslist[i]<<i;
 			return;
 		}
 	}
@@ -364,42 +516,508 @@ void recover(FILE* fout)
 			for (int i=1;i<56;i++)
 				if ((wrongsite1==i)||(wrongsite2==i)) guesslist[i] = 1-predictresult[i][guesslist[i-1]];//regarded as wrong guess
 				else guesslist[i] = predictresult[i][guesslist[i-1]];
-			if (keyoracle())
+			if (keyoracle(guesslist,kc))
 			{
-				twobitmiss++;
-				fprintf(fout,"                ");
-				for (int i=55;i>=0;i--) fprintf(fout,"%d",(guesslist[i]+get_pos_i(h[2],i))%2);
-				fprintf(fout,"\n");
-				fprintf(fout,"2 bit miss\n");
+				r.outcome = 2;
+				for (int i=0;i<56;i++) r.guess |= (unsigned long long)guesslist[i]<<i;
 				return;
 			}
 		}
-	overthreebitmiss++;
-	fprintf(fout,"over 3 bits miss\n");
+	r.outcome = 3;
 }
 
-int main()
+struct candidate
 {
-	srand((int)time(0));
-	char filename[20] = "output.txt";
-	FILE* fout = fopen(filename,"w");
-	for (int i=1;i<=keynum;i++)
+	double cost;  //-log of the likelihood of the guesses so far
+	unsigned long long guess;  //bit i: guesslist[i]
+};
+
+double guesscost(double z) //-log(Phi(z)): cost of a guess the test supports with margin z (against it if z < 0)
+{
+	if (z>-30) return -log(0.5*erfc(-z/sqrt(2.0)));
+	return z*z/2+log(-z*sqrt(2*M_PI));
+}
+
+double transitioncost(double zscore[56][2],int i,int j,int x) //guesslist[i] = x after guesslist[i-1] = j (j = 0 for i = 0)
+{
+	int belowbit = (j==0)?1:0;//guess of test (i,j) if the bias is below the bound
+	if (x==belowbit) return guesscost(zscore[i][j]);
+	else return guesscost(-zscore[i][j]);
+}
+
+//out = the listsize best of a (cost +ca) and b (cost +cb), both sorted, with guesslist[i] = x
+void mergelist(const vector<candidate> &a,double ca,const vector<candidate> &b,double cb,int i,int x,vector<candidate> &out)
+{
+	out.clear();
+	size_t p = 0,q = 0;
+	while ((out.size()<(size_t)listsize)&&((p<a.size())||(q<b.size())))
+	{
+		candidate c;
+		if ((q>=b.size())||((p<a.size())&&(a[p].cost+ca<=b[q].cost+cb)))
+		{
+			c = a[p++];
+			c.cost += ca;
+		}
+		else
+		{
+			c = b[q++];
+			c.cost += cb;
+		}
+		c.guess |= (unsigned long long)x<<i;
+		out.push_back(c);
+	}
+}
+
+//list Viterbi over the trellis guesslist[i] = f(guesslist[i-1]), ranked by the likelihood of the measured biases
+void recover_soft(double zscore[56][2],keycheck &kc,keyresult &r) //fill r.guess, r.rank and r.outcome
+{
+	vector<candidate> list[2],next[2];
+	for (int x=0;x<2;x++)
+	{
+		candidate c = {transitioncost(zscore,0,0,x),(unsigned long long)x};
+		list[x].push_back(c);
+	}
+	for (int i=1;i<56;i++)
 	{
-		key1 = simple_ran64();
-		key2 = simple_ran64();
-		getgoalbitlist();
-		biastest();
-		fprint_longlong_in_binary(key1,fout);
-		fprint_longlong_in_binary(key2,fout);
-		recover(fout);
+		for (int x=0;x<2;x++) mergelist(list[0],transitioncost(zscore,i,0,x),list[1],transitioncost(zscore,i,1,x),i,x,next[x]);
+		list[0].swap(next[0]);
+		list[1].swap(next[1]);
+	}
+	vector<candidate> ranked;
+	mergelist(list[0],0,list[1],0,0,0,ranked);
+	r.guess = 0;
+	r.rank = 0;
+	for (size_t c=0;c<ranked.size();c++)
+		if (keyoracle(ranked[c].guess,kc))
+		{
+			r.guess = ranked[c].guess;
+			r.rank = c+1;
+			break;
+		}
+	if (r.rank==0) r.outcome = 4;
+	else if (r.rank==1) r.outcome = 0;
+	else if (r.rank<=57) r.outcome = 1;
+	else if (r.rank<=1597) r.outcome = 2;
+	else r.outcome = 3;
+}
+
+//oracle data of --guess, shared by all guesses of k_1: count[i][m] = differences of test (i,m) computed with k_1 = 0,
+//so that test (i,j) of a guess g is count[i][j^g[i-1]]
+long long guesstest(const sipctx &ctx,unsigned long long stream,long long count[56][2]) //return pairs used
+{
+	count[0][0] = testcount(0,ctx,stream,0,0,0,inputnum);
+	count[0][1] = count[0][0];
+	for (int i=1;i<56;i++)
+		for (int m=0;m<2;m++) count[i][m] = testcount(0,ctx,stream,i,m,0,inputnum);
+	return 111*(long long)inputnum;
+}
+
+//tc[i][g][j][x]: cost of guesslist[i] = x after guesslist[i-1] = j, under k_1[i-1] = g
+void guesscosts(long long count[56][2],double tc[56][2][2][2])
+{
+	for (int i=0;i<56;i++)
+		for (int g=0;g<2;g++)
+			for (int j=0;j<2;j++)
+			{
+				int belowbit = (j==0)?1:0;
+				double z = margin(i,j,count[i][j^g],inputnum);
+				if (i==0) z = margin(0,0,count[0][0],inputnum);
+				for (int x=0;x<2;x++) tc[i][g][j][x] = guesscost((x==belowbit)?z:-z);
+			}
+}
+
+//suffix[i][x]: cheapest cost of guesslist[i+1] to guesslist[55] after guesslist[i] = x, over all guesses of k_1[55-guesswidth] to k_1[54],
+//return the cost of the cheapest guess (exact, since k_1[i-1] only enters the transition to guesslist[i])
+double guessbound(double tc[56][2][2][2],unsigned long long k1,double suffix[56][2])
+{
+	suffix[55][0] = 0;
+	suffix[55][1] = 0;
+	for (int i=55;i>0;i--)
+		for (int j=0;j<2;j++)
+		{
+			suffix[i-1][j] = INFINITY;
+			for (int g=0;g<2;g++)
+			{
+				if ((i-1<55-guesswidth)&&(g!=get_pos_i(k1,i-1))) continue;//known bit
+				for (int x=0;x<2;x++) suffix[i-1][j] = min(suffix[i-1][j],tc[i][g][j][x]+suffix[i][x]);
+			}
+		}
+	return min(tc[0][0][0][0]+suffix[0][0],tc[0][0][0][1]+suffix[0][1]);
+}
+
+double rightcost(double tc[56][2][2][2],unsigned long long k1) //cost of the right guess
+{
+	double cost[2];
+	for (int x=0;x<2;x++) cost[x] = tc[0][0][0][x];
+	for (int i=1;i<56;i++)
+	{
+		int g = get_pos_i(k1,i-1);
+		double c0 = min(cost[0]+tc[i][g][0][0],cost[1]+tc[i][g][1][0]);
+		double c1 = min(cost[0]+tc[i][g][0][1],cost[1]+tc[i][g][1][1]);
+		cost[0] = c0;
+		cost[1] = c1;
+	}
+	return min(cost[0],cost[1]);
+}
+
+//abortmargin: the (1-abortmiss) quantile of the gap between the costs of the right guess and of the cheapest guess,
+//over calibnum keys following the keynum keys of the run
+void calibrate(unsigned long long seed,int nthread)
+{
+	vector<double> gap(calibnum);
+	sip_parallel_for(nthread,calibnum,[&](long long c,int)
+	{
+		sipkey key = sip_rng_key(seed,keynum+c);
+		unsigned long long stream = sip_rng_stream(seed,keynum+c,SIP_RNG_MESSAGE);
+		long long count[56][2];
+		double tc[56][2][2][2],suffix[56][2];
+		guesstest(sip_prepare(key),stream,count);
+		guesscosts(count,tc);
+		gap[c] = rightcost(tc,key.k1)-guessbound(tc,key.k1,suffix);
+	});
+	sort(gap.begin(),gap.end());
+	int q = (int)ceil((1-abortmiss)*calibnum)-1;
+	if (q<0) q = 0;
+	if (q>calibnum-1) q = calibnum-1;
+	abortmargin = gap[q];
+}
+
+//all 2^guesswidth guesses of k_1[55-guesswidth] to k_1[54] (the other bits of k1 known) in Gray-code order,
+//each decoded as by --soft with a list of 1 and aborted as soon as it cannot cost less than the cheapest guess plus abortmargin
+void guessengine(long long count[56][2],unsigned long long k1,guessstat &gs)
+{
+	double tc[56][2][2][2],suffix[56][2];
+	guesscosts(count,tc);
+	double limit = guessbound(tc,k1,suffix)+abortmargin;
+	double cost[56][2];  //cost[i][x]: cheapest path to guesslist[i] = x
+	for (int x=0;x<2;x++) cost[0][x] = tc[0][0][0][x];
+	//the right guess, decoded once to rank the others against it
+	gs.cost = rightcost(tc,k1);
+	auto start = chrono::steady_clock::now();
+	int w = guesswidth;
+	long long total = 1LL<<w;
+	unsigned long long guess = k1&((1ULL<<(55-w))-1);  //Gray code 0: guessed bits all 0
+	unsigned long long gray = 0;
+	//Gray-code bit t is k_1[54-t], so that the bits flipped most often come last in the chain,
+	//and the guesses sharing k_1[0] to k_1[i-1] form aligned blocks of 2^(55-i) guesses
+	int valid = 1;  //cost[0] to cost[valid-1] belong to the current guess
+	long long better = 0;
+	gs.guesses = total;
+	gs.aborted = 0;
+	gs.survivors = 0;
+	for (long long n=0;n<total;)
+	{
+		int i;
+		for (i=valid;i<56;i++)
+		{
+			int g = (guess>>(i-1))&1;
+			for (int x=0;x<2;x++) cost[i][x] = min(cost[i-1][0]+tc[i][g][0][x],cost[i-1][1]+tc[i][g][1][x]);
+			if (min(cost[i][0]+suffix[i][0],cost[i][1]+suffix[i][1])>limit) break;//no completion is cheap enough
+		}
+		long long step = 1;
+		if (i<56)  //cost[i] only depends on k_1[0] to k_1[i-1]: the whole block of guesses sharing them is aborted
+		{
+			step = 1LL<<min(w,55-i);
+			gs.aborted += step;
+			valid = i;
+		}
+		else
+		{
+			gs.survivors++;
+			if (min(cost[55][0],cost[55][1])<gs.cost) better++;
+			valid = 56;
+		}
+		n = (n|(step-1))+1;
+		if (n>=total) break;
+		unsigned long long diff = gray^(n^(n>>1));
+		gray ^= diff;
+		while (diff!=0)
+		{
+			int b = 54-__builtin_ctzll(diff);
+			diff &= diff-1;
+			guess ^= 1ULL<<b;
+			if (b+1<valid) valid = b+1;
+		}
+	}
+	gs.seconds = chrono::duration<double>(chrono::steady_clock::now()-start).count();
+	if (gs.cost<=limit) gs.rank = better+1;
+	else gs.rank = 0;
+}
+
+void fprint_keyresult(const keyresult &r,FILE* fout)
+{
+	fprint_longlong_in_binary(r.key.k0,fout);
+	fprint_longlong_in_binary(r.key.k1,fout);
+	if (guesswidth>0)
+	{
+		const guessstat &gs = r.gs;
+		fprintf(fout,"guesses %lld aborted %lld survivors %lld rank %lld cost %.2f\n",gs.guesses,gs.aborted,gs.survivors,gs.rank,gs.cost);
 		fprintf(fout,"\n");
+		return;
+	}
+	if (soft?(r.rank>0):(r.outcome<3))
+	{
+		fprintf(fout,"                ");
+		for (int i=55;i>=0;i--) fprintf(fout,"%d",get_pos_i(r.guess^sip_h[2],i));
+		fprintf(fout,"\n");
+	}
+	if (soft&&(r.rank>0)) fprintf(fout,"rank %d\n",r.rank);
+	else if (soft) fprintf(fout,"not in list\n");
+	else fprintf(fout,"%s\n",outcomename[r.outcome]);
+	if (adaptive) fprintf(fout,"queries %lld\n",r.queries);
+	if (searchmode&&(soft?(r.rank>0):(r.outcome<3))) fprintf(fout,"key %016llx%016llx searched %d time %.3fs\n",r.found.k0,r.found.k1,r.searched,r.seconds);
+	else if (searchmode) fprintf(fout,"key not found searched %d time %.3fs\n",r.searched,r.seconds);
+	fprintf(fout,"\n");
+}
+
+//95% Wilson score interval of a success rate of found out of n
+void wilson(long long found,long long n,double &low,double &high)
+{
+	double z = 1.96;
+	double p = found*1.0/n;
+	double center = (p+z*z/(2*n))/(1+z*z/n);
+	double half = z*sqrt(p*(1-p)/n+z*z/(4.0*n*n))/(1+z*z/n);
+	low = max(0.0,center-half);
+	high = min(1.0,center+half);
+}
+
+//success rate of the recovery for inputnum = 2^sweeplo to 2^sweephi on the same keys: the pairs of each test are counted once,
+//up to 2^sweephi, and the counts after 2^a pairs are the bias tests of grid point a
+//and for every key count K of sweepkeys (--sweep-keys, keynum alone by default), on the first K keys
+//with --adaptive, grid point a is a run of --adaptive with maxinputnum = 2^a and budgetnum = 111*2^a
+int runsweep(unsigned long long seed,int nthread)
+{
+	int gridnum = sweephi-sweeplo+1;
+	vector<int> success(keynum,0);//bit g: key recovered at grid point g
+	vector<long long> queries((long long)keynum*gridnum,0);//pairs used by key i at grid point g, at queries[i*gridnum+g]
+	sip_parallel_for(nthread,keynum,[&](long long keycount,int)
+	{
+		sipkey key = sip_rng_key(seed,keycount);
+		unsigned long long stream = sip_rng_stream(seed,keycount,SIP_RNG_MESSAGE);
+		sipctx ctx = sip_prepare(key);
+		keycheck kc;
+		getgoalbitlist(key,kc.goalbitlist);
+		long long count[56][2];
+		for (int i=0;i<56;i++)
+			for (int j=0;j<2;j++) count[i][j] = 0;
+		long long num = 0;
+		for (int g=0;g<gridnum;g++)
+		{
+			long long next = 1LL<<(sweeplo+g);
+			int predictresult[56][2];
+			double zscore[56][2];
+			keyresult r;
+			if (adaptive)
+			{
+				queries[keycount*gridnum+g] = biastest_adaptive(key,stream,predictresult,zscore,next,111*next);
+				if (soft) recover_soft(zscore,kc,r);
+				else recover(predictresult,kc,r);
+				if (soft?(r.rank>0):(r.outcome<3)) success[keycount] |= 1<<g;
+				continue;
+			}
+			queries[keycount*gridnum+g] = 111*next;
+			for (int i=0;i<56;i++)
+				for (int j=0;j<2;j++)
+				{
+					if ((i==0)&&(j==1)) continue;
+					count[i][j] += testcount(key.k1,ctx,stream,i,j,num,next-num);
+					predictresult[i][j] = predict(i,j,count[i][j],next);
+					zscore[i][j] = margin(i,j,count[i][j],next);
+				}
+			num = next;
+			if (soft) recover_soft(zscore,kc,r);
+			else recover(predictresult,kc,r);
+			if (soft?(r.rank>0):(r.outcome<3)) success[keycount] |= 1<<g;
+		}
+	});
+	FILE* fout = fopen("output_sweep.txt","w");
+	if (fout==NULL) return -1;
+	fprintf(fout,"inputnum queries keys success rate low high\n");
+	for (int keys : sweepkeys)
+	{
+		if (sweepkeys.size()>1) printf("keys:%d\n",keys);
+		int cheapest = -1,cheapestlow = -1;
+		for (int g=0;g<gridnum;g++)
+		{
+			long long found = 0,used = 0;
+			for (int i=0;i<keys;i++)
+			{
+				found += (success[i]>>g)&1;
+				used += queries[(long long)i*gridnum+g];
+			}
+			double rate = found*1.0/keys,low,high;
+			wilson(found,keys,low,high);
+			long long n = 1LL<<(sweeplo+g);
+			double average = used*1.0/keys;//111*n without --adaptive
+			fprintf(fout,"%lld %lld %d %lld %.4f %.4f %.4f\n",n,llround(average),keys,found,rate,low,high);
+			printf("inputnum:2^%d queries:2^%.2f success:%lld/%d rate:%.4f [%.4f,%.4f]\n",sweeplo+g,log(average)/log(2),found,keys,rate,low,high);
+			if ((cheapest<0)&&(rate>=0.95)) cheapest = sweeplo+g;
+			if ((cheapestlow<0)&&(low>=0.95)) cheapestlow = sweeplo+g;
+		}
+		if (cheapest>=0) printf("cheapest inputnum with success rate >= 0.95: 2^%d\n",cheapest);
+		if (cheapestlow>=0) printf("cheapest inputnum with 95%% interval >= 0.95: 2^%d\n",cheapestlow);
 	}
-	fprintf(fout,"all correct:%d\n",allcorrect);
-	fprintf(fout,"1 bit misses:%d\n",onebitmisses);
-	fprintf(fout,"2 bit miss:%d\n",twobitmiss);
-	fprintf(fout,"over 3 bits miss:%d\n",overthreebitmiss);
 	fclose(fout);
 	return 0;
 }
 
-
+int main(int argc, char* argv[])
+{
+	int nthread = sip_parse_threads(argc,argv);
+	adaptive = sip_parse_flag(argc,argv,"--adaptive");
+	soft = sip_parse_flag(argc,argv,"--soft");
+	searchmode = sip_parse_flag(argc,argv,"--search");
+	sweep = sip_parse_flag(argc,argv,"--sweep");
+	keynum = sip_parse_value(argc,argv,"--keys",keynum);
+	const char* sweepkeyname = sip_parse_string(argc,argv,"--sweep-keys",NULL);
+	if (sweepkeyname!=NULL)//"K1,K2,...": the sweep runs on the largest count
+	{
+		sweep = true;
+		for (const char* p=sweepkeyname;*p!='\0';p++)
+		{
+			int keys = atoi(p);
+			if (keys>0) sweepkeys.push_back(keys);
+			p = strchr(p,',');
+			if (p==NULL) break;
+		}
+		sort(sweepkeys.begin(),sweepkeys.end());
+		if (!sweepkeys.empty()) keynum = sweepkeys.back();
+	}
+	if (sweepkeys.empty()) sweepkeys.push_back(keynum);
+	guesswidth = sip_parse_value(argc,argv,"--guess",0);
+	if (guesswidth<0) guesswidth = 0;
+	if (guesswidth>55) guesswidth = 55;
+	unsigned long long seed = sip_rng_seed();
+	printf("seed:%016llx\n",seed);
+	testrange = adaptive?maxinputnum:inputnum;
+	if (sweep&&(searchmode||(guesswidth>0)))
+	{
+		printf("option --sweep does not go with --search or --guess\n");
+		return -1;
+	}
+	if (sweep)
+	{
+		testrange = 1LL<<sweephi;
+		return runsweep(seed,nthread);
+	}
+	if (guesswidth>0)
+	{
+		calibrate(seed,nthread);
+		printf("abort margin:%.2f\n",abortmargin);
+	}
+	char filename[20] = "output.txt";
+	FILE* fout = fopen(filename,"w");
+	//keys spread over nthread threads, each with its own statistics, results written in key order
+	vector<keyresult> result(keynum);
+	int outcomenum = soft?5:4;
+	vector<vector<int> > outcomecount(nthread,vector<int>(outcomenum,0));
+	sip_ordered ord(keynum);
+	sip_parallel_for(nthread,keynum,[&](long long keycount,int thread)
+	{
+		keyresult &r = result[keycount];
+		keycheck kc;
+		int predictresult[56][2];
+		double zscore[56][2];
+		r.key = sip_rng_key(seed,keycount);
+		getgoalbitlist(r.key,kc.goalbitlist);
+		unsigned long long stream = sip_rng_stream(seed,keycount,SIP_RNG_MESSAGE);
+		if (guesswidth>0)
+		{
+			long long count[56][2];
+			r.queries = guesstest(sip_prepare(r.key),stream,count);
+			guessengine(count,r.key.k1,r.gs);
+			sip_ordered_done(ord,keycount,[&](long long i){fprint_keyresult(result[i],fout);});
+			return;
+		}
+		auto start = chrono::steady_clock::now();
+		if (searchmode)//known k_1 bits and (message, tag) pairs: messages of the key stream after k_0 and k_1
+		{
+			unsigned long long keystream = sip_rng_stream(seed,keycount,SIP_RNG_KEY);
+			kc.k1 = r.key.k1&0x007fffffffffffff;
+			for (int t=0;t<tagnum;t++)
+			{
+				kc.message[t] = withpadding(sip_ran64(keystream,2+t));
+				kc.tag[t] = siphash_2_1(r.key,kc.message[t]);
+			}
+			kc.searched = 0;
+		}
+		if (adaptive) r.queries = biastest_adaptive(r.key,stream,predictresult,zscore,maxinputnum,budgetnum);
+		else r.queries = biastest(r.key,stream,predictresult,zscore);
+		if (soft) recover_soft(zscore,kc,r);
+		else recover(predictresult,kc,r);
+		if (searchmode)
+		{
+			r.found = kc.found;
+			r.searched = kc.searched;
+			r.seconds = chrono::duration<double>(chrono::steady_clock::now()-start).count();
+		}
+		outcomecount[thread][r.outcome]++;
+		sip_ordered_done(ord,keycount,[&](long long i){fprint_keyresult(result[i],fout);});
+	});
+	if (guesswidth>0)
+	{
+		long long guesses = 0,aborted = 0,survivors = 0,rank = 0,found = 0;
+		double seconds = 0;
+		for (int i=0;i<keynum;i++)
+		{
+			const guessstat &gs = result[i].gs;
+			guesses += gs.guesses;
+			aborted += gs.aborted;
+			survivors += gs.survivors;
+			seconds += gs.seconds;
+			if (gs.rank>0)
+			{
+				found++;
+				rank += gs.rank;
+			}
+		}
+		//check: the right guess is aborted for about abortmiss of the keys, and the wrong guesses are aborted
+		long long wrongaborted = aborted-(keynum-found);
+		double wrongrate = wrongaborted*1.0/(guesses-keynum);
+		double expected = abortmiss*keynum;
+		bool passed = (keynum-found<=expected+3*sqrt(expected)+3)&&(wrongaborted>0);
+		fprintf(fout,"abort margin:%.2f\n",abortmargin);
+		fprintf(fout,"right guess survived:%lld\n",found);
+		fprintf(fout,"average survivors:%.2f of %lld guesses, aborted:%.2f%%\n",survivors*1.0/keynum,guesses/keynum,aborted*100.0/guesses);
+		fprintf(fout,"wrong guesses aborted:%.2f%%\n",wrongrate*100);
+		fprintf(fout,"average rank of right guess:%.2f\n",(found>0)?rank*1.0/found:0.0);
+		fprintf(fout,"time per guess:%.2fns\n",seconds*1e9/guesses);
+		fprintf(fout,"check %s\n",passed?"passed":"failed");
+		printf("right guess survived:%lld/%d wrong guesses aborted:%.2f%% average survivors:%.2f time per guess:%.2fns\n",found,keynum,wrongrate*100,survivors*1.0/keynum,seconds*1e9/guesses);
+		printf("check %s: right guess aborted for %lld keys (about %.1f expected), %lld wrong guesses aborted\n",passed?"passed":"failed",keynum-found,expected,wrongaborted);
+		fclose(fout);
+		return passed?0:1;
+	}
+	for (int c=0;c<outcomenum;c++)
+	{
+		int sum = 0;
+		for (int t=0;t<nthread;t++) sum += outcomecount[t][c];
+		fprintf(fout,"%s:%d\n",soft?softname[c]:outcomename[c],sum);
+	}
+	if (searchmode)
+	{
+		double searched = 0,seconds = 0;
+		int wrong = 0;
+		for (int i=0;i<keynum;i++)
+		{
+			const keyresult &r = result[i];
+			searched += r.searched;
+			seconds += r.seconds;
+			if ((soft?(r.rank>0):(r.outcome<3))&&((r.found.k0!=r.key.k0)||(r.found.k1!=r.key.k1))) wrong++;
+		}
+		fprintf(fout,"average candidates searched:%.2f\n",searched/keynum);
+		fprintf(fout,"average time per key:%.3fs\n",seconds/keynum);
+		fprintf(fout,"verified keys different from the key:%d\n",wrong);
+		printf("average candidates searched:%.2f average time per key:%.3fs\n",searched/keynum,seconds/keynum);
+	}
+	if (adaptive)
+	{
+		double queries = 0;
+		for (int i=0;i<keynum;i++) queries += result[i].queries;
+		queries = queries/keynum;
+		fprintf(fout,"average queries:%.0f (2^%.2f)\n",queries,log(queries)/log(2));
+		printf("average queries:%.0f (2^%.2f), fixed: %lld (2^%.2f)\n",queries,log(queries)/log(2),111*(long long)inputnum,log(111.0*inputnum)/log(2));
+	}
+	fclose(fout);
+	return 0;
+}
@@ -12,6 +12,8 @@
 	
 	Program must be executed with 1 operational parameter k(operational parameter) \
 	  with file "sip21test_k.txt" existing under directory "./data".
+	If "sip21test_k.bin" (written by the Data Generation Program, or converted from the text file by common/bias_convert.cpp) \
+	  is also there, it is loaded instead through mmap, which takes milliseconds instead of parsing the text file.
 	i.e.:
 		./siphash21_analysis 07
 		./siphash21_analysis 43
@@ -33,17 +35,19 @@
 #include<cstdlib>
 #include<cstring>
 #include<cmath>
+#include"../../common/biasstore.h"
+#include"../../common/biasanalysis.h"
 using namespace std;
 
 const int keynum = 4096;
 
-double data[64][keynum];
+short biasdata[64][keynum];//bias*100 of output bit j of key i, as the two decimals of the data file
 
 void initdata()
 {
 	for (int i=0;i<64;i++)
 		for (int j=0;j<keynum;j++)
-			data[i][j] = 0.0;
+			biasdata[i][j] = 0;
 }
 
 void loaddata(char* name)
@@ -54,54 +58,57 @@ void loaddata(char* name)
 	for (int i=0;i<keynum;i++)
 	{
 		string key1,key2;
-		int site,flag,group;
+		int site;
+		double bias;
 		fin>>key1;
 		fin>>key2;
 		for (int j=0;j<64;j++)
 		{
 			fin>>site;
-			fin>>data[j][i];
+			fin>>bias;
+			biasdata[j][i] = (short)lround(bias*100);
 		}
 	}
 	fin.close();
 	cout<<"load "<<name<<" finished\n";
 }
 
+//the same data from the binary file written next to the text file, false if it is missing or of another run
+bool loadbin(char* name)
+{
+	biasstore st;
+	if (!biasstore_open(name,st)) return false;
+	if ((st.head->variant!=SIPBIAS_BIASTEST)||(st.head->keynum!=keynum))
+	{
+		biasstore_close(st);
+		return false;
+	}
+	initdata();
+	for (int j=0;j<64;j++) memcpy(biasdata[j],st.column+(long long)j*keynum,keynum*sizeof(short));
+	biasstore_close(st);
+	cout<<"load "<<name<<" finished\n";
+	return true;
+}
+
 int main(int argc, char* argv[])
 {
 	//filename
 	char filename[40] = "./data/sip21test_";
 	strcat(filename,argv[1]);
 	strcat(filename,".txt");
-	loaddata(filename);
-	//analyze
-	int maxtime[64];
-	for (int j=0;j<64;j++) maxtime[j] = 0;
+	char binname[40];
+	strcpy(binname,filename);
+	strcpy(binname+strlen(binname)-4,".bin");
+	if (!loadbin(binname)) loaddata(filename);
+	//analyze, one key at a time (common/biasanalysis.h)
+	biasstat st;
+	biasstat_init(st);
 	for (int i=0;i<keynum;i++)
 	{
-		double maxbias_key = -100.0;
-		int maxsite_key = -1;
-		for (int j=0;j<64;j++)
-			if (data[j][i]>maxbias_key)
-			{
-				maxbias_key = data[j][i];
-				maxsite_key = j;
-			}
-		maxtime[maxsite_key]++;
-	}
-	for (int j=0;j<64;j++)
-	{
-		if (maxtime[j]==0) continue;
-		double sum = 0.0;
-		double maxbias_j = -100.0;
-		double minbias_j = 0.0;
-		for (int i=0;i<keynum;i++)
-		{
-			sum = sum+data[j][i];
-			if (data[j][i]>maxbias_j) maxbias_j = data[j][i];
-			if (data[j][i]<minbias_j) minbias_j = data[j][i];
-		}
-		printf("j:%d times:%d average:%.2f max:%.2f min:%.2f\n",j,maxtime[j],sum/keynum,maxbias_j,minbias_j);
+		short fixed[64];
+		for (int j=0;j<64;j++) fixed[j] = biasdata[j][i];
+		biasstat_add(st,fixed);
 	}
+	biasstat_print(st,stdout);
 	return 0;
 }
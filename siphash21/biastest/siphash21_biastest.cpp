@@ -7,6 +7,8 @@
 	For each key, program randomly chooses inputnum(internal parameter) pairs of input message differing on bit k(operational parameter), \
 	  or say input1^input2 = 1<<k, and calculates corresponding biases of all 64 output bits.
 	All input messages are restricted into one 64-bit block.
+	Keys and messages are drawn from the counter-based generator in common/siprng.h, indexed by (seed, key index, message index).
+	The seed is printed on start; a run can be replayed with the environment variable SIPHASH_SEED set to it.
 	Those internal parameters can be directly modified in the first page, \
 	  but the authors still suggest the original version inputnum = 1048576 and keynum = 4096.
 	
@@ -14,12 +16,35 @@
 	i.e.:
 		./siphash21_biastest 07
 		./siphash21_biastest 43
+	An optional parameter "bitslice" switches the hashing backend to the bitsliced engine (common/siphash_bitslice.h), \
+	  which gives the same output file from an independent implementation of SipHash-2-1, as a check of the default SIMD backend.
+	It is slower than the default backend (4~7 times in common/siphash_bench.cpp, whichever instruction set), \
+	  so it is only meant for cross-checking a machine or a compiler on a few keys, not for whole runs.
+	i.e.:
+		./siphash21_biastest 07 bitslice
+		./siphash21_biastest 07 -j 16 bitslice
+	Options "-j N" (threads), "--resume" (checkpoints), "--shard i" and "--extend N" (runs over more messages) \
+	  and "--stream" (statistics of siphash21_analysis.cpp without the text file) are those of all the generators, see common/biasrun.h.
+	i.e.:
+		./siphash21_biastest 07 -j 16 --resume
+		SIPHASH_SEED=0x1234 ./siphash21_biastest 07 -j 16 --shard 1
+		./siphash21_biastest 07 -j 16 --extend 15728640
+		./siphash21_biastest 07 -j 16 --stream
+	Option "--masks file" replaces the input bit k by the input masks (any 64-bit input differences) \
+	  and the 64 output bits by the output masks (biases of the parity of the output difference on the mask) listed in the file (see common/maskcounter.h), \
+	  all of them evaluated on the same inputnum messages of every key, with the same keys and messages as without the option.
+	It goes with "-j N" and "--shard i" only (see common/biasrun.h), and k is not needed.
+	i.e.:
+		./siphash21_biastest --masks masks.txt -j 16
 	
 	Output Format
 		One execution will produce one output file named "sip21test_k.txt", where k can discriminate different execution.
 		Each output file records the information of keynum keys.
 		Each key contains 66 lines of information, \
 		  with 2 lines of key information (64-bit per line) and 64 lines of bias information (one output bit per line).
+		The same results are also written to "sip21test_k.bin" in the binary columnar format of common/biasstore.h, \
+		  which the analysis program loads much faster than the text file, \
+		  together with the raw counters of every key and output bit, so that runs can be merged or extended later.
 		Each line of bias information contains 2 number, the former is the output bit and the latter is the output bias (exponential part).
 	i.e.:
 		1234567890abcdef
@@ -29,6 +54,16 @@
 		02 -6.73
 		...
 		63 -9.83
+	With option "--masks file", the output file is named "sip21mask_file" and each key contains one line per input mask and output mask \
+	  (input mask, output mask, bias) instead of one line per output bit.
+	The standard output gives, as siphash21_analysis.cpp, the times of being the greatest and the average, biggest and smallest biases \
+	  of every pair of masks that has been the greatest for some key, and the pair of masks with the greatest average bias.
+	i.e.:
+		1234567890abcdef
+		fedcba0987654321
+		0000000000000080 0000000000020000 -4.42
+		0000000000000080 0000000200020000 -8.91
+		...
 	
 	The entire experiment needs 64 times of executions, while one execution costs several hours on an ordinary PC.
 	It is suggested that prople who would like to recover the experiment have enough parallel computing resources.
@@ -41,13 +76,22 @@
 #include<cstdlib>
 #include<cstring>
 #include<ctime>
+#include<string>
+#include<vector>
+#include"../../common/siphash_bitslice.h"
+#include"../../common/bitcounter.h"
+#include"../../common/maskcounter.h"
+#include"../../common/siprng.h"
+#include"../../common/sipthread.h"
+#include"../../common/biasrun.h"
 
 using namespace std;
 
 //internal parameters
 long long inputnum = 1048576;//2^20
-long long halfinputnum = 524288;
 int keynum = 4096;
+int checkpointinterval = 60;//seconds between checkpoints
+const int batchnum = 512;//messages per SIMD batch
 //internal parameters
 
 unsigned long long leftrotate(unsigned long long a,int length)  //64-bit left-rotate 
@@ -69,19 +113,6 @@ unsigned long long flip_pos_i(unsigned long long a,int i)  //64-bit flip-bit
 	return (a^(yi<<i));
 }
 
-unsigned long long simple_ran64()  //64-bit randomize
-{
-	//modular different Mersenne Prime to avoid circulation
-	unsigned long long u,v,w,x,y,z;
-	u = rand()%31;
-	v = rand()%127;
-	w = rand()%8191;
-	x = rand()%8191;
-	y = rand()%8191;
-	z = rand()%8191;
-	return ((u<<59)|(v<<52)|(w<<39)|(x<<26)|(y<<13)|z);
-}
-
 void print_longlong_in_binary(unsigned long long a)
 {
 	for (int j=63;j>=0;j--) cout<<get_pos_i(a,j);
@@ -100,65 +131,6 @@ void fprint_longlong_in_hex(unsigned long long a,FILE* fout)
 	fprintf(fout,"%08x%08x\n",left32,right32);
 }
 
-//siphash
-unsigned long long key1,key2;
-unsigned long long ff = 0x00000000000000ff;
-unsigned long long h[4] = {0x736f6d6570736575,0x646f72616e646f6d,0x6c7967656e657261,0x7465646279746573};
-unsigned long long v[4];
-unsigned long long siphash_2_1(unsigned long long m)
-{
-	//init
-	v[0] = h[0]^key1;
-	v[1] = h[1]^key2;
-	v[2] = h[2]^key1;
-	v[3] = h[3]^key2;
-	//init
-	//2-round compression
-	v[3] = v[3]^m;
-	for (int i=1;i<=2;i++)
-	{
-		v[0] = v[0]+v[1];
-		v[2] = v[2]+v[3];
-		v[1] = leftrotate(v[1],13);
-		v[3] = leftrotate(v[3],16);
-		v[1] = v[0]^v[1];
-		v[3] = v[2]^v[3];
-		v[0] = leftrotate(v[0],32);
-		//halfround
-		v[2] = v[1]+v[2];
-		v[0] = v[0]+v[3];
-		v[1] = leftrotate(v[1],17);
-		v[3] = leftrotate(v[3],21);
-		v[1] = v[1]^v[2];
-		v[3] = v[0]^v[3];
-		v[2] = leftrotate(v[2],32);
-	}
-	v[0] = v[0]^m;
-	//2-round compression
-	//1-round finalization
-	v[2] = v[2]^ff;
-	for (int i=1;i<=1;i++)
-	{
-		v[0] = v[0]+v[1];
-		v[2] = v[2]+v[3];
-		v[1] = leftrotate(v[1],13);
-		v[3] = leftrotate(v[3],16);
-		v[1] = v[0]^v[1];
-		v[3] = v[2]^v[3];
-		v[0] = leftrotate(v[0],32);
-		//halfround
-		v[2] = v[1]+v[2];
-		v[0] = v[0]+v[3];
-		v[1] = leftrotate(v[1],17);
-		v[3] = leftrotate(v[3],21);
-		v[1] = v[1]^v[2];
-		v[3] = v[0]^v[3];
-		v[2] = leftrotate(v[2],32);
-	}
-	//1-round finalization
-	return (v[0]^v[1]^v[2]^v[3]);
-} 
-//siphash
 
 char knum[10];
 void myitoa(int k)
@@ -177,45 +149,61 @@ int chartoint(char* s)
 
 int main(int argc, char* argv[])
 {
-	srand((int)time(0));
-	long long counter[64];//output differential counter
-	//load k
-	int k = chartoint(argv[1]);
-	//filename
-	char filename[20] = "sip21test_";
-	strcat(filename,argv[1]);
-	strcat(filename,".txt");
-	FILE* fout = fopen(filename,"w");
-	//test for the k-th input differential bit
-	for (int keycount=0;keycount<keynum;keycount++)
+	biasrun r;
+	biasrun_options(r,argc,argv);
+	bool bitslice = sip_parse_flag(argc,argv,"bitslice");
+	int k = -1;
+	if (r.maskname!=NULL)//k is not needed
 	{
-		//init
-		for (int j=0;j<64;j++) counter[j] = 0;
-		key1 = simple_ran64();
-		key2 = simple_ran64();
-		//test
-		for (int inputcount=1;inputcount<=inputnum;inputcount++)
+		if (bitslice)
 		{
-			unsigned long long message = simple_ran64();
-			unsigned long long message_pie = flip_pos_i(message,k);
-			unsigned long long output = siphash_2_1(message);
-			unsigned long long output_pie = siphash_2_1(message_pie);
-			unsigned long long diffrence = output^output_pie;
-			for (int j=0;j<64;j++)
-				if (get_pos_i(diffrence,j)==1) counter[j]++;
+			printf("option --masks only goes with -j and --shard\n");
+			return -1;
 		}
-		//output
-		fprint_longlong_in_hex(key1,fout);
-		fprint_longlong_in_hex(key2,fout);
-		for (int j=0;j<64;j++)
+		if (!biasrun_start_masks(r,"sip21mask_",keynum,inputnum)) return -1;
+	}
+	else
+	{
+		//load k
+		k = chartoint(argv[1]);
+		//program and output files
+		char program[40] = "siphash21_biastest ";
+		strcat(program,argv[1]);
+		char name[20] = "sip21test_";
+		strcat(name,argv[1]);
+		if (!biasrun_start(r,program,name,SIPBIAS_BIASTEST,k,-1,1,keynum,inputnum,checkpointinterval)) return -1;
+	}
+	//test for the k-th input differential bit, keys spread over the threads
+	biasrun_keys(r,[&](long long keycount,sipkey &key,long long* counter)
+	{
+		bitcounter bc;//vertical accumulator of counter
+		unsigned long long message[batchnum],diffrence[batchnum];
+		//init
+		bitcounter_init(bc);
+		key = sip_rng_key(r.seed,keycount);
+		unsigned long long stream = sip_rng_stream(r.seed,keycount,SIP_RNG_MESSAGE);
+		sipctx ctx = sip_prepare(key);
+		//test
+		for (long long inputcount=0;inputcount<r.inputnum;inputcount+=batchnum)
 		{
-			if (j>9) fprintf(fout,"%d ",j);
-			else fprintf(fout,"0%d ",j);
-			if (counter[j]==halfinputnum) fprintf(fout,"-21.00\n");
-			else fprintf(fout,"%.2f\n",log(abs(counter[j]-halfinputnum))/log(2)-log(inputnum)/log(2));
+			int num = batchnum;
+			if (r.inputnum-inputcount<num) num = r.inputnum-inputcount;
+			sip_ran64_batch(stream,r.first+inputcount,message,num);
+			if (r.maskname!=NULL)
+			{
+				siphash_2_1_mask_count(ctx,r.ms,message,num,counter);
+				continue;
+			}
+			if (bitslice)
+			{
+				siphash_2_1_bitslice_count(ctx,message,num,flip_pos_i(0,k),counter);
+				continue;
+			}
+			siphash_2_1_pair_batch(ctx,message,flip_pos_i(0,k),diffrence,num);
+			bitcounter_add(bc,diffrence,num);
 		}
-		fprintf(fout,"\n");
-	}
-	fclose(fout);
+		if (r.maskname==NULL) bitcounter_flush(bc,counter);
+	});
+	biasrun_finish(r);
 	return 0;
-} 
+}
@@ -11,9 +11,17 @@
 	
 	Program must be executed with 2 operational parameters k(operational parameter) and n(operational parameter), \
 	  with file "sip21test_k_n.txt" existing under directory "./data".
+	If "sip21test_k_n.bin" (written by the Data Generation Program, or converted from the text file by common/bias_convert.cpp) \
+	  is also there, it is loaded instead through mmap, which takes milliseconds instead of parsing the text file.
 	i.e.:
 		./siphash21_analysis_k 07 0
 		./siphash21_analysis_k 43 1
+	The keys of each output bit are counted into a histogram of their biases (common/biashist.h) instead of being sorted, \
+	  and the best boundline of every output bit is found in one sweep over its histogram (biascond in common/biasanalysis.h).
+	Option "-j N" analyses N output bits at the same time on N threads ("-j 0": one thread per core); \
+	  the outputs do not depend on N, and the program must be compiled with -pthread.
+	i.e.:
+		./siphash21_analysis_k 07 0 -j 0
 	
 	Output Format
 		Program only produces standard outputs.
@@ -43,39 +51,20 @@
 #include<cstdlib>
 #include<cstring>
 #include<cmath>
+#include"../../common/biasstore.h"
+#include"../../common/biasanalysis.h"
+#include"../../common/sipthread.h"
 using namespace std;
 
 const int keynum = 4*4096;
 
-struct testdata
-{
-	double bias;
-	int flag;
-};
-testdata data[64][keynum];
+short biasdata[64][keynum];//bias*100 of output bit j of key i, as the two decimals of the data file
 
 void initdata()
 {
 	for (int i=0;i<64;i++)
-	{
 		for (int j=0;j<keynum;j++)
-		{
-			data[i][j].bias = 0.0;
-			data[i][j].flag = -1;
-		}
-	}
-}
-
-void sortdata(int k)
-{
-	for (int i=0;i<keynum-1;i++)
-		for (int j=i+1;j<keynum;j++)
-			if (data[k][i].bias>data[k][j].bias)
-			{
-				testdata temp = data[k][i];
-				data[k][i] = data[k][j];
-				data[k][j] = temp;
-			}
+			biasdata[i][j] = 0;
 }
 
 void loaddata(char* name)
@@ -86,105 +75,60 @@ void loaddata(char* name)
 	for (int i=0;i<keynum;i++)
 	{
 		string key1,key2;
-		int site,flag,group;
+		int site;
+		double bias;
 		fin>>key1;
 		fin>>key2;
-		flag = i/(keynum/4);
 		for (int j=0;j<64;j++)
 		{
 			fin>>site;
-			fin>>data[j][i].bias;
-			data[j][i].flag = flag;
+			fin>>bias;
+			biasdata[j][i] = (short)lround(bias*100);
 		}
 	}
 	fin.close();
 	cout<<"load "<<name<<" finished\n";
 }
 
-double mymax(double a,double b)
+//the same data from the binary file written next to the text file, false if it is missing or of another run
+bool loadbin(char* name)
 {
-	if (a>b) return a;
-	else return b;
+	biasstore st;
+	if (!biasstore_open(name,st)) return false;
+	if ((st.head->variant!=SIPBIAS_CONDTEST)||(st.head->keynum!=keynum))
+	{
+		biasstore_close(st);
+		return false;
+	}
+	initdata();
+	for (int j=0;j<64;j++) memcpy(biasdata[j],st.column+(long long)j*keynum,keynum*sizeof(short));
+	biasstore_close(st);
+	cout<<"load "<<name<<" finished\n";
+	return true;
 }
 
 int main(int argc, char* argv[])
 {
+	int nthread = sip_parse_threads(argc,argv);
 	//filename
 	char filename[40] = "./data/sip21test_";
 	strcat(filename,argv[1]);
 	strcat(filename,"_");
 	strcat(filename,argv[2]);
 	strcat(filename,".txt");
-	loaddata(filename);
-	//analyze
-	int maxj = -1;
-	double maxp = 0;
-	double maxbound = 0.0;
-	for (int j=0;j<64;j++)
-	{
-		sortdata(j);
-		double maxp_ofj = 0;
-		double maxbound_ofj = 0.0;
-		int p0 = 0;
-		int q0 = 0;
-		int p1 = 0;
-		int q1 = 0;
-		for (int i=0;i<keynum;i++)
-		{
-			if (data[j][i].flag==0) p0++;
-			if (data[j][i].flag==1) q0++;
-			if (data[j][i].flag==2) p1++;
-			if (data[j][i].flag==3) q1++;
-			if (data[j][i].bias<-9) continue;
-			if ((i<keynum-1)&&(data[j][i+1].bias==data[j][i].bias)) continue;
-			double pp0 = p0*1.0/(keynum/4);
-			double qq0 = q0*1.0/(keynum/4);
-			double pp1 = p1*1.0/(keynum/4);
-			double qq1 = q1*1.0/(keynum/4);
-			double p = (mymax(pp0*qq0,pp1*qq1)+mymax(pp0+qq0-2*pp0*qq0,pp1+qq1-2*pp1*qq1)+mymax((1-pp0)*(1-qq0),(1-pp1)*(1-qq1)))/2;
-			if (p>maxp_ofj)
-			{
-				maxp_ofj = p;
-				maxbound_ofj = data[j][i].bias+0.005;
-			}
-		}
-		printf("site:%d bound:%.3f p:%.3f\n",j,maxbound_ofj,maxp_ofj);
-		if (maxp_ofj>maxp)
-		{
-			maxj = j;
-			maxp = maxp_ofj;
-			maxbound = maxbound_ofj;
-		}
-	}
-	printf("\n");
-	printf("best choice:\n");
-	printf("site:%d bound:%.3f\n",maxj,maxbound);
-	int maxp0 = 0;
-	int maxq0 = 0;
-	int maxp1 = 0;
-	int maxq1 = 0;
+	char binname[40];
+	strcpy(binname,filename);
+	strcpy(binname+strlen(binname)-4,".bin");
+	if (!loadbin(binname)) loaddata(filename);
+	//analyze (common/biasanalysis.h)
+	biascond c;
+	biascond_init(c,4,keynum);
 	for (int i=0;i<keynum;i++)
 	{
-		if (data[maxj][i].bias<maxbound)
-		{
-			if (data[maxj][i].flag==0) maxp0++;
-			if (data[maxj][i].flag==1) maxq0++;
-			if (data[maxj][i].flag==2) maxp1++;
-			if (data[maxj][i].flag==3) maxq1++;
-		}
+		short fixed[64];
+		for (int j=0;j<64;j++) fixed[j] = biasdata[j][i];
+		biascond_add(c,i,fixed);
 	}
-	double maxpp0 = maxp0*1.0/(keynum/4);
-	double maxqq0 = maxq0*1.0/(keynum/4);
-	double maxpp1 = maxp1*1.0/(keynum/4);
-	double maxqq1 = maxq1*1.0/(keynum/4);
-	printf("p1:%.3f q1:%.3f p2:%.3f q2:%.3f p_v2[k]:%.3f ",maxpp0,maxqq0,maxpp1,maxqq1,maxp);
-	double max1 = mymax(maxpp0,maxqq0)/(maxpp0+maxqq0);
-	double max2 = mymax(1-maxpp0,1-maxqq0)/(2-maxpp0-maxqq0);
-	double max3 = mymax(maxpp1,maxqq1)/(maxpp1+maxqq1);
-	double max4 = mymax(1-maxpp1,1-maxqq1)/(2-maxpp1-maxqq1);
-	double p0_v3 = (1-maxpp0-maxqq0+2*maxpp0*maxqq0)*0.5+(maxpp0+maxqq0-2*maxpp0*maxqq0)*mymax(max1,max2);
-	double p1_v3 = (1-maxpp1-maxqq1+2*maxpp1*maxqq1)*0.5+(maxpp1+maxqq1-2*maxpp1*maxqq1)*mymax(max3,max4);
-	double p_v3 = (p0_v3+p1_v3)/2;
-	printf("p_v3[k-1]:%.3f\n",p_v3);
+	biascond_print(c,-1,stdout,nthread);
 	return 0;
 }
@@ -0,0 +1,190 @@
+/*
+	Report Program - Summary Tables of All Bias Test and Key Classification Results
+		(For the analysis of a single file, see biastest/siphash21_analysis.cpp and condtest/siphash21_analysis_k.cpp)
+	For any question, please email to he-l17@mails.tsinghua.edu.cn.
+
+	This program loads the results of all executions of the Data Generation Programs at once, \
+	  and computes for each of them the same statistics as the corresponding analysis program:
+		Bias Test, k:00~63: for each output bit that has been the greatest, \
+		  the times of being the greatest, the average, biggest and smallest biases (as siphash21_analysis.cpp)
+		Key Classification, k:01~63 and n:0~1: the best output bit and boundline, with p1,q1,p2,q2 \
+		  and the success rates of recovering v2[k] and v3[k-1] (as siphash21_analysis_k.cpp)
+	Files are loaded from "sip21test_k.bin" (or "sip21test_k_n.bin") if present, otherwise parsed in place from the mapped text file \
+	  (common/biasstore.h); files that are missing are skipped.
+	Files are loaded and analysed in parallel, with option "-j N" ("-j 0": one thread per core); the program must be compiled with -pthread.
+
+	Program must be executed under directory "siphash21", with 1 optional operational parameter csv(default) or json.
+	i.e.:
+		./siphash21_report
+		./siphash21_report json -j 0
+
+	Output Format
+		2 files, "report_biastest.csv" with one line per k and output bit, "report_condtest.csv" with one line per k and n \
+		  (or "report_biastest.json" and "report_condtest.json", one object per line of the csv files), \
+		  and one line of standard output per table.
+	i.e.:
+		report_biastest.csv
+			k,j,times,average,max,min
+			7,17,1071,-4.42,-3.37,-5.89
+			7,33,3025,-4.26,-3.28,-5.68
+			...
+		report_condtest.csv
+			k,n,site,bound,p,p1,q1,p2,q2,p_v2,p_v3
+			32,0,58,-5.485,0.908,0.000,0.156,0.966,0.165,0.908,0.726
+			...
+		standard output
+			report_biastest.csv files:64 lines:127
+			report_condtest.csv files:126 lines:126
+*/
+
+#include<iostream>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<cmath>
+#include<string>
+#include<vector>
+#include"../common/biasstore.h"
+#include"../common/biasanalysis.h"
+#include"../common/sipthread.h"
+
+using namespace std;
+
+struct biastestrow
+{
+	int k,j,times;
+	double average,max,min;
+};
+struct condtestrow
+{
+	int k,n,site;
+	double bound,p,p1,q1,p2,q2,p_v2,p_v3;
+};
+
+//"name.bin" if it is a file of this variant, otherwise "name.txt"
+bool loadfile(const char* name,int variant,int k,int n,int groups,biaswriter &w)
+{
+	string binname = string(name)+".bin";
+	if (biaswriter_load(w,binname.c_str())&&(w.head.variant==variant)) return true;
+	string txtname = string(name)+".txt";
+	return biaswriter_parse_text(w,txtname.c_str(),variant,k,n,groups,0);
+}
+
+//siphash21_analysis.cpp
+void biastest(const biaswriter &w,int k,vector<biastestrow> &rows)
+{
+	long long keynum = w.head.keynum;
+	biasstat st;
+	biasstat_init(st);
+	for (long long i=0;i<keynum;i++)
+	{
+		short fixed[64];
+		biaswriter_row(w,i,fixed);
+		biasstat_add(st,fixed);
+	}
+	for (int j=0;j<64;j++)
+	{
+		if (st.maxtime[j]==0) continue;
+		biastestrow row = {k,j,st.maxtime[j],st.sum[j]/keynum,st.max[j],st.min[j]};
+		rows.push_back(row);
+	}
+}
+
+//siphash21_analysis_k.cpp
+void condtest(const biaswriter &w,int k,int n,vector<condtestrow> &rows)
+{
+	long long keynum = w.head.keynum;
+	biascond c;
+	biascond_init(c,4,keynum);
+	for (long long i=0;i<keynum;i++)
+	{
+		short fixed[64];
+		biaswriter_row(w,i,fixed);
+		biascond_add(c,i,fixed);
+	}
+	biascond_sweep(c);
+	if (c.maxj<0) return;
+	double pp[4];
+	biascond_choice(c,c.maxj,pp);
+	condtestrow row = {k,n,c.maxj,c.leftbound[c.maxj]+0.005,c.p[c.maxj],pp[0],pp[1],pp[2],pp[3],c.p[c.maxj],biascond_p_v3(c)};
+	rows.push_back(row);
+}
+
+int main(int argc, char* argv[])
+{
+	int nthread = sip_parse_threads(argc,argv);
+	bool json = (argc>1)&&(strcmp(argv[1],"json")==0);
+	const char* ext = json?"json":"csv";
+	//one task per file: bias test k = task, key classification k = (task-64)/2+1, n = (task-64)%2
+	int tasknum = 64+126;
+	vector<vector<biastestrow> > biasrows(64);
+	vector<vector<condtestrow> > condrows(126);
+	vector<char> found(tasknum,0);
+	sip_parallel_for(nthread,tasknum,[&](long long task,int)
+	{
+		char name[40];
+		biaswriter w;
+		if (task<64)
+		{
+			int k = task;
+			sprintf(name,"./biastest/data/sip21test_%02d",k);
+			if (!loadfile(name,SIPBIAS_BIASTEST,k,-1,1,w)||(w.head.keynum==0)) return;
+			found[task] = 1;
+			biastest(w,k,biasrows[task]);
+		}
+		else
+		{
+			int k = (task-64)/2+1;
+			int n = (task-64)%2;
+			sprintf(name,"./condtest/data/sip21test_%02d_%d",k,n);
+			if (!loadfile(name,SIPBIAS_CONDTEST,k,n,4,w)||(w.head.keynum<4)) return;
+			found[task] = 1;
+			condtest(w,k,n,condrows[task-64]);
+		}
+	});
+	//bias test table
+	char filename[40];
+	sprintf(filename,"report_biastest.%s",ext);
+	FILE* fout = fopen(filename,"w");
+	if (fout==NULL) return -1;
+	int files = 0,lines = 0;
+	if (json) fprintf(fout,"[\n");
+	else fprintf(fout,"k,j,times,average,max,min\n");
+	for (int k=0;k<64;k++)
+	{
+		files += found[k];
+		for (size_t r=0;r<biasrows[k].size();r++)
+		{
+			const biastestrow &row = biasrows[k][r];
+			if (json) fprintf(fout,"%s{\"k\":%d,\"j\":%d,\"times\":%d,\"average\":%.2f,\"max\":%.2f,\"min\":%.2f}",(lines>0)?",\n":"",row.k,row.j,row.times,row.average,row.max,row.min);
+			else fprintf(fout,"%d,%d,%d,%.2f,%.2f,%.2f\n",row.k,row.j,row.times,row.average,row.max,row.min);
+			lines++;
+		}
+	}
+	if (json) fprintf(fout,"%s]\n",(lines>0)?"\n":"");
+	fclose(fout);
+	printf("%s files:%d lines:%d\n",filename,files,lines);
+	//key classification table
+	sprintf(filename,"report_condtest.%s",ext);
+	fout = fopen(filename,"w");
+	if (fout==NULL) return -1;
+	files = 0;
+	lines = 0;
+	if (json) fprintf(fout,"[\n");
+	else fprintf(fout,"k,n,site,bound,p,p1,q1,p2,q2,p_v2,p_v3\n");
+	for (int t=0;t<126;t++)
+	{
+		files += found[64+t];
+		for (size_t r=0;r<condrows[t].size();r++)
+		{
+			const condtestrow &row = condrows[t][r];
+			if (json) fprintf(fout,"%s{\"k\":%d,\"n\":%d,\"site\":%d,\"bound\":%.3f,\"p\":%.3f,\"p1\":%.3f,\"q1\":%.3f,\"p2\":%.3f,\"q2\":%.3f,\"p_v2\":%.3f,\"p_v3\":%.3f}",(lines>0)?",\n":"",row.k,row.n,row.site,row.bound,row.p,row.p1,row.q1,row.p2,row.q2,row.p_v2,row.p_v3);
+			else fprintf(fout,"%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",row.k,row.n,row.site,row.bound,row.p,row.p1,row.q1,row.p2,row.q2,row.p_v2,row.p_v3);
+			lines++;
+		}
+	}
+	if (json) fprintf(fout,"%s]\n",(lines>0)?"\n":"");
+	fclose(fout);
+	printf("%s files:%d lines:%d\n",filename,files,lines);
+	return 0;
+}
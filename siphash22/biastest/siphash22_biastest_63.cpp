@@ -6,13 +6,37 @@
 	  or say input1^input2 = 0x1000000000000000, and calculates corresponding biases of output bit 57.
 		(To reduce running time, here we make use of the conclusion of our teammates that \
 		  under input diffential bit k, the ouput bit with the most significant bias locates on bit k+58 mod 64)
+	Only output bit 57 is counted, in registers (siphash_cd_pair_count in common/siphash_simd.h); the pairs are still hashed on the whole state.
 	All input messages are restricted into one 64-bit block.
+	The key and messages come from common/siprng.h; the seed is printed on start and SIPHASH_SEED=<seed> replays the same key and messages.
 	The authors suggest setting inputnum = 2^36, which is enough to check whether the output bias is greater than 2^-17.
 	Test results provided by the authors with 256 keys are obtained under parameter inputnum = 2^40. 
 	
 	Program can be executed directly without any operational parameters.
 	One execution only returns the result of one key in "sip22test_63.txt", yet costing several hours on an ordinary PC.
-	It is suggested that prople who would like to recover the experiment have enough parallel computing resources.
+	Option "-j N" splits the inputnum samples into chunks of chunksize(internal parameter) pairs, handed out to N threads ("-j 0": one thread per core).
+	Chunk c always hashes the messages with indices c*chunksize onwards, and each thread only adds to its own counter, \
+	  so the result does not depend on N or on which thread took which chunk.
+	i.e.:
+		./siphash22_biastest_63
+		./siphash22_biastest_63 -j 64
+	Option "--resume" continues an interrupted run from its last checkpoint "sip22test_63.txt.ckpt", \
+	  which keeps the seed, the number of finished chunks and their count, is rewritten every checkpointinterval(internal parameter) seconds \
+	  and is removed when the run completes.
+	i.e.:
+		./siphash22_biastest_63 -j 64 --resume
+	Option "--sequential" checks after every chunk (in chunk order) whether the bias is already resolved, \
+	  i.e. whether it is certainly above 2^targetbias or certainly below it (internal parameters, 2^-17 as above), and stops as soon as it is.
+	The check is a confidence sequence: with n pairs after t chunks, the bias lies within \
+	  sqrt(ln(2t(t+1)/significance)/2n) of the measured one, at all t at the same time except with probability significance(internal parameter), \
+	  so checking after every chunk does not inflate the error (Hoeffding bound, with a union bound over the checks).
+	Keys with a clearly greater bias stop long before inputnum pairs; the bias is then computed from the pairs actually used, \
+	  and their number is reported. Keys that are not resolved run to inputnum pairs and give the same result as without the option.
+	With the default parameters only the upper side can be resolved: at inputnum = 2^36 (4096 chunks) the radius is still about 2^-16.2, \
+	  above 2^-17, so keys below the target always run the full inputnum pairs; the program says so on start.
+	Certainly below 2^-17 takes about 2^38 pairs for a bias close to 0, and more the closer it is to 2^-17.
+	i.e.:
+		./siphash22_biastest_63 -j 64 --sequential
 	
 	Output Format
 		Each key contains 3 lines of information, \
@@ -22,6 +46,9 @@
 		1234567890abcdef
 		fedcba0987654321
 		57 -15.67
+	With option "--sequential", a 4th line gives the number of pairs actually used.
+	i.e.:
+		samples 4294967296
 */
 
 #include<iostream>
@@ -31,14 +58,21 @@
 #include<cstdlib>
 #include<cstring>
 #include<ctime>
+#include<atomic>
+#include"../../common/siphash_simd.h"
+#include"../../common/siprng.h"
+#include"../../common/sipthread.h"
+#include"../../common/sipcheckpoint.h"
 
 using namespace std;
 
 //internal parameters
 long long inputnum = 68719476736;//2^36
-long long halfinputnum = 34359738368;
-long long roundnum = 64;
-long long roundinputnum = 1073741824;//2^30
+long long chunksize = 16777216;//2^24 samples per chunk handed to a thread
+double targetbias = -17;//log2 of the bias to be resolved by --sequential
+double significance = 0.001;//probability that --sequential stops with a wrong decision
+int checkpointinterval = 60;//seconds between checkpoints
+const int batchnum = 256;//messages per SIMD batch
 //internal parameters
 
 unsigned long long leftrotate(unsigned long long a,int length)  //64-bit left-rotate 
@@ -60,19 +94,6 @@ unsigned long long flip_pos_i(unsigned long long a,int i)  //64-bit flip-bit
 	return (a^(yi<<i));
 }
 
-unsigned long long simple_ran64()  //64-bit randomize
-{
-	//modular different Mersenne Prime to avoid circulation
-	unsigned long long u,v,w,x,y,z;
-	u = rand()%31;
-	v = rand()%127;
-	w = rand()%8191;
-	x = rand()%8191;
-	y = rand()%8191;
-	z = rand()%8191;
-	return ((u<<59)|(v<<52)|(w<<39)|(x<<26)|(y<<13)|z);
-}
-
 void print_longlong_in_binary(unsigned long long a)
 {
 	for (int j=63;j>=0;j--) cout<<get_pos_i(a,j);
@@ -91,90 +112,92 @@ void fprint_longlong_in_hex(unsigned long long a,FILE* fout)
 	fprintf(fout,"%08x%08x\n",left32,right32);
 }
 
-//siphash
-unsigned long long key1,key2;
-unsigned long long ff = 0x00000000000000ff;
-unsigned long long h[4] = {0x736f6d6570736575,0x646f72616e646f6d,0x6c7967656e657261,0x7465646279746573};
-unsigned long long v[4];
-unsigned long long siphash_2_2(unsigned long long m)
-{
-	//init
-	v[0] = h[0]^key1;
-	v[1] = h[1]^key2;
-	v[2] = h[2]^key1;
-	v[3] = h[3]^key2;
-	//init
-	//2-round compression
-	v[3] = v[3]^m;
-	for (int i=1;i<=2;i++)
-	{
-		v[0] = v[0]+v[1];
-		v[2] = v[2]+v[3];
-		v[1] = leftrotate(v[1],13);
-		v[3] = leftrotate(v[3],16);
-		v[1] = v[0]^v[1];
-		v[3] = v[2]^v[3];
-		v[0] = leftrotate(v[0],32);
-		//halfround
-		v[2] = v[1]+v[2];
-		v[0] = v[0]+v[3];
-		v[1] = leftrotate(v[1],17);
-		v[3] = leftrotate(v[3],21);
-		v[1] = v[1]^v[2];
-		v[3] = v[0]^v[3];
-		v[2] = leftrotate(v[2],32);
-	}
-	v[0] = v[0]^m;
-	//2-round compression
-	//2-round finalization
-	v[2] = v[2]^ff;
-	for (int i=1;i<=2;i++)
-	{
-		v[0] = v[0]+v[1];
-		v[2] = v[2]+v[3];
-		v[1] = leftrotate(v[1],13);
-		v[3] = leftrotate(v[3],16);
-		v[1] = v[0]^v[1];
-		v[3] = v[2]^v[3];
-		v[0] = leftrotate(v[0],32);
-		//halfround
-		v[2] = v[1]+v[2];
-		v[0] = v[0]+v[3];
-		v[1] = leftrotate(v[1],17);
-		v[3] = leftrotate(v[3],21);
-		v[1] = v[1]^v[2];
-		v[3] = v[0]^v[3];
-		v[2] = leftrotate(v[2],32);
-	}
-	//2-round finalization
-	return (v[0]^v[1]^v[2]^v[3]);
-} 
-//siphash
 
-int main()
+int main(int argc, char* argv[])
 {
-	srand((int)time(0)); 
+	int nthread = sip_parse_threads(argc,argv);
+	bool resume = sip_parse_flag(argc,argv,"--resume");
+	bool sequential = sip_parse_flag(argc,argv,"--sequential");
+	unsigned long long seed = sip_rng_seed();
 	long long counter_57 = 0;//output differential counter
+	long long chunknum = (inputnum+chunksize-1)/chunksize;
+	long long* chunkcounter = new long long[chunknum];//pairs with a difference on output bit 57 in each chunk
 	int k = 63;
 	char filename[20] = "sip22test_63.txt";
-	FILE* fout = fopen(filename,"w");
-	key1 = simple_ran64();
-	key2 = simple_ran64();
-	for (int roundcount=1;roundcount<=roundnum;roundcount++)
+	//checkpoint
+	char ckptname[40];
+	sprintf(ckptname,"%s.ckpt",filename);
+	char tag[100];
+	sprintf(tag,"siphash22_biastest_63 inputnum=%lld chunksize=%lld",inputnum,chunksize);
+	if (sequential) sprintf(tag+strlen(tag)," sequential targetbias=%g significance=%g",targetbias,significance);
+	sipcheckpoint cp = {seed,0,0,0};
+	if (resume&&sip_checkpoint_load(ckptname,tag,cp))
 	{
-		for (int inputcount=1;inputcount<=roundinputnum;inputcount++)
+		seed = cp.seed;
+		printf("resume from chunk %lld of %lld\n",cp.cursor,chunknum);
+	}
+	printf("seed:%016llx\n",seed);
+	if (sequential&&(sqrt(log(2.0*chunknum*(chunknum+1)/significance)/(2.0*inputnum))>=pow(2,targetbias)))
+		printf("sequential: only biases above 2^%g can be resolved within inputnum pairs\n",targetbias);
+	time_t last = time(0);
+	sipkey key = sip_rng_key(seed,0);
+	unsigned long long stream = sip_rng_stream(seed,0,SIP_RNG_MESSAGE);
+	sipctx ctx = sip_prepare(key);
+	//chunks spread over nthread threads, each with its own counter
+	long long usednum = inputnum;//pairs in the result
+	atomic<bool> resolved(false);
+	sip_ordered ord(chunknum,cp.cursor);
+	sip_parallel_for(nthread,cp.cursor,chunknum,[&](long long chunk,int)
+	{
+		if (resolved) return;//chunks after an early stop are skipped
+		unsigned long long message[batchnum];
+		long long counter[64];//only bit 57 is evaluated
+		counter[57] = 0;
+		long long first = chunk*chunksize;
+		long long end = first+chunksize;
+		if (end>inputnum) end = inputnum;
+		for (long long inputcount=first;inputcount<end;inputcount+=batchnum)
 		{
-			unsigned long long message = simple_ran64();
-			unsigned long long message_pie = flip_pos_i(message,k);
-			unsigned long long output = siphash_2_2(message);
-			unsigned long long output_pie = siphash_2_2(message_pie);
-			unsigned long long diffrence = output^output_pie;
-			if (get_pos_i(diffrence,57)==0) counter_57++;
+			int num = batchnum;
+			if (end-inputcount<num) num = end-inputcount;
+			sip_ran64_batch(stream,inputcount,message,num);
+			siphash_2_2_pair_count(ctx,message,num,flip_pos_i(0,k),flip_pos_i(0,57),counter);
 		}
+		chunkcounter[chunk] = counter[57];
+		//reduce in chunk order, so that the checkpoint covers a prefix of the chunks
+		sip_ordered_done(ord,chunk,[&](long long i)
+		{
+			if (resolved) return;
+			cp.count += chunkcounter[i];
+			cp.cursor = i+1;
+			if (sequential)
+			{
+				//confidence sequence on the bias after the first i+1 chunks
+				long long n = min((i+1)*chunksize,inputnum);
+				double bias = fabs((n-cp.count)-n/2.0)/n;
+				double radius = sqrt(log(2.0*(i+1)*(i+2)/significance)/(2.0*n));
+				if ((bias-radius>pow(2,targetbias))||(bias+radius<pow(2,targetbias)))
+				{
+					usednum = n;
+					resolved = true;
+					return;
+				}
+			}
+			if (sip_checkpoint_due(last,checkpointinterval)) sip_checkpoint_save(ckptname,tag,cp);
+		});
+	});
+	counter_57 = usednum-cp.count;//pairs without a difference on bit 57
+	FILE* fout = fopen(filename,"w");
+	fprint_longlong_in_hex(key.k0,fout);
+	fprint_longlong_in_hex(key.k1,fout);
+	fprintf(fout,"57 %.2f\n",log(fabs(counter_57-usednum/2.0))/log(2)-log(usednum)/log(2));
+	if (sequential)
+	{
+		fprintf(fout,"samples %lld\n",usednum);
+		printf("samples:%lld (2^%.2f)%s\n",usednum,log(usednum)/log(2),resolved?" resolved":"");
 	}
-	fprint_longlong_in_hex(key1,fout);
-	fprint_longlong_in_hex(key2,fout);
-	fprintf(fout,"57 %.2f\n",log(abs(counter_57-halfinputnum))/log(2)-log(inputnum)/log(2));
 	fclose(fout);
+	sip_checkpoint_remove(ckptname);
+	delete[] chunkcounter;
 	return 0;
 }